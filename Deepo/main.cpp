@@ -19,114 +19,471 @@ Signature_Type Current_Signature;
 // Define Found Fuse
 uint8_t Fuses [5]; // copy of fuses/lock bytes found for this processor
 
+// Define Digital SPI (bit banged ISP core on the B100BB pins, also drives RESET whichever transport carries the data)
+typedef ISP_Core <B100BB_Board> Digital_SPI;
+
+// Define Digital SPI Delay (set by Set_ISP_Speed)
+uint8_t Digital_SPI_Delay = B100BB_Board::Bit_Delay;
+
+// Define Current Speed Level
+int8_t ISP_Speed = 0;
+bool ISP_Speed_Locked = false;
+
 // Digital SPI Data Transfer
 uint8_t Digital_SPI_Transfer (byte c) {
-	byte bit;
 
-	for (bit = 0; bit < 8; bit++)
-	{
-		// write MOSI on falling edge of previous clock
-		if (c & 0x80)
-			Digital_MOSI_PORT |= bit(Digital_MOSI_PIN);
-		else
-			Digital_MOSI_PORT &= ~bit(Digital_MOSI_PIN);
-		c <<= 1;
+	// End Function
+	return (Digital_SPI::Transfer (c, Digital_SPI_Delay));
+
+}
+
+#if ISP_TRANSPORT == ISP_MSPIM
+
+// MSPIM SPI Start (USART0 in master SPI mode, SPI mode 0, MSB first)
+void MSPIM_SPI_Start (void) {
+
+	// Clear Baud Rate
+	UBRR0 = 0;
+
+	// Set XCK (SCK) as OUTPUT
+	MSPIM_XCK_DDR |= (1 << MSPIM_XCK_PIN);
+
+	// Set Master SPI Mode
+	UCSR0C = (1 << UMSEL00) | (1 << UMSEL01);
+
+	// Enable Transmitter and Receiver
+	UCSR0B = (1 << TXEN0) | (1 << RXEN0);
+
+	// Set Baud Rate (must be set after the transmitter is enabled, SCK = F_CPU / (2 * (UBRR0 + 1)))
+	UBRR0 = (F_CPU / 2 + Target_Clock / ISP_Clock_Fraction - 1) / (Target_Clock / ISP_Clock_Fraction) - 1;
+
+}
+
+// MSPIM SPI Stop
+void MSPIM_SPI_Stop (void) {
+
+	// Disable USART
+	UCSR0B = 0;
+	UCSR0C = 0;
+
+	// Set XCK as INPUT
+	MSPIM_XCK_DDR &= ~(1 << MSPIM_XCK_PIN);
+
+}
+
+// MSPIM SPI Data Transfer
+uint8_t MSPIM_SPI_Transfer (uint8_t c) {
+
+	// Wait for Transmit Buffer
+	while ((UCSR0A & (1 << UDRE0)) == 0) {}
+
+	// Transfer Data
+	UDR0 = c;
+
+	// Wait for Received Data
+	while ((UCSR0A & (1 << RXC0)) == 0) {}
+
+	// Return Data
+	return UDR0;
+
+}
+
+#endif
+
+#if ISP_TRANSPORT == ISP_HWSPI
+
+// Define Hardware SPI Registers
+uint8_t Hardware_SPI_Control, Hardware_SPI_Status, Hardware_SPI_Base_Rate;
 
-		// read MISO
-		c |= (Digital_MISO_PORT & bit(Digital_MISO_PIN)) != 0;
+// Hardware SPI Rate (rate n divides F_CPU by 2^(n+1))
+void Hardware_SPI_Rate (const uint8_t _Rate) {
 
-		// clock high
-		Digital_SCK_PORT |= bit(Digital_SCK_PIN);
+	// Set Registers
+	Hardware_SPI_Control = (1 << SPE) | (1 << MSTR) | (_Rate / 2);
+	Hardware_SPI_Status = (_Rate < 6 && (_Rate & 1) == 0) ? (1 << SPI2X) : 0;
 
-		// delay between rise and fall of clock
-		delayMicroseconds(6);
+}
+
+// Hardware SPI Start (the bus itself was set up by sd.begin)
+void Hardware_SPI_Start (void) {
+
+	// take the fastest rate not above the ISP clock
+	uint8_t _Rate = 0;
+	for (uint32_t _SCK = F_CPU / 2; _SCK > Target_Clock / ISP_Clock_Fraction && _Rate < 6; _SCK /= 2) _Rate++;
+
+	// Set Rate
+	Hardware_SPI_Base_Rate = _Rate;
+	Hardware_SPI_Rate (_Rate);
+
+}
+
+// Hardware SPI Data Transfer
+uint8_t Hardware_SPI_Transfer (uint8_t c) {
+
+	// SdFat sets its own clock on the shared bus, so put ours back each time
+	SPCR = Hardware_SPI_Control;
+	SPSR = Hardware_SPI_Status;
+
+	// Transfer Data
+	SPDR = c;
+
+	// Wait for Transfer
+	while ((SPSR & (1 << SPIF)) == 0) {}
+
+	// Return Data
+	return SPDR;
+
+}
+
+#endif
 
-		// clock low
-		Digital_SCK_PORT &= ~bit(Digital_SCK_PIN);
+// Define Current Transport
+uint8_t ISP_Transport = ISP_BITBANG;
+uint8_t (* SPI_Transfer) (uint8_t c) = Digital_SPI_Transfer;
+
+// Define ISP Queue (instructions clocked out one SCK edge per timer 2 compare match, so the Digital SPI delays are free for the main loop at the slow clock recovery levels)
+// sequence numbers count up from 0 and wrap, the slot is number % ISP_Queue_Size; head is changed by the main loop only, tail by the interrupt only
+ISP_Instruction_Type ISP_Queue [ISP_Queue_Size];
+volatile uint8_t ISP_Queue_Head, ISP_Queue_Tail;
+uint8_t ISP_Queue_Byte, ISP_Queue_Bits_Left, ISP_Queue_Shift;
+bool ISP_Queue_SCK_High;
+
+// ISP Queue Interrupt (one SCK edge of the instruction at the tail, MOSI out and MISO in on the rising edge as Digital_SPI::Transfer does)
+ISR (TIMER2_COMPA_vect) {
+
+	// Instruction at the Tail
+	ISP_Instruction_Type & _Instruction = ISP_Queue [ISP_Queue_Tail % ISP_Queue_Size];
+
+	// Falling Edge
+	if (ISP_Queue_SCK_High) {
+
+		// Clock LOW
+		Digital_SPI::SCK::Low ();
+		ISP_Queue_SCK_High = false;
+		if (--ISP_Queue_Bits_Left > 0) return;
+
+		// Byte Done (keep what came back)
+		_Instruction.Data [ISP_Queue_Byte] = ISP_Queue_Shift;
+		if (++ISP_Queue_Byte < 4) return;
+
+		// Instruction Done (stop once there are no more)
+		ISP_Queue_Byte = 0;
+		if (++ISP_Queue_Tail == ISP_Queue_Head) TIMSK2 &= ~(1 << OCIE2A);
+		return;
 
-		// delay between rise and fall of clock
-		delayMicroseconds(6);
 	}
 
-	return c;
+	// Start Byte
+	if (ISP_Queue_Bits_Left == 0) {
+
+		ISP_Queue_Shift = _Instruction.Data [ISP_Queue_Byte];
+		ISP_Queue_Bits_Left = 8;
+
+	}
+
+	// Write MOSI, Read MISO
+	if (ISP_Queue_Shift & 0x80) Digital_SPI::MOSI::High (); else Digital_SPI::MOSI::Low ();
+	ISP_Queue_Shift = (ISP_Queue_Shift << 1) | Digital_SPI::MISO::Read ();
+
+	// Clock HIGH
+	Digital_SPI::SCK::High ();
+	ISP_Queue_SCK_High = true;
+
 }
 
+// Set ISP Queue Speed (compare match every Digital_SPI_Delay uS, the interrupt itself adds to that)
+void Set_ISP_Queue_Speed (void) {
 
+	OCR2A = max (Digital_SPI_Delay * (F_CPU / 8 / 1000000UL), 1UL) - 1;
 
-// Digital SPI Start Programming
+}
+
+// Start ISP Queue (timer 2 in CTC mode at F_CPU / 8, its interrupt is enabled while the queue holds something)
+void Start_ISP_Queue (void) {
+
+	// Empty Queue
+	TIMSK2 = 0;
+	ISP_Queue_Head = ISP_Queue_Tail = 0;
+	ISP_Queue_Byte = ISP_Queue_Bits_Left = 0;
+	ISP_Queue_SCK_High = false;
+
+	// Set CTC Mode, F_CPU / 8
+	TCCR2A = (1 << WGM21);
+	TCCR2B = (1 << CS21);
+	Set_ISP_Queue_Speed ();
+
+}
+
+// Flush ISP Queue (wait for everything queued to be sent)
+// no Busy_Work while the queue runs: the SD card select (D10) is Digital SPI SCK on the B100BB, so the card is only used between instructions
+void Flush_ISP_Queue (void) {
+
+	while (ISP_Queue_Tail != ISP_Queue_Head);
+
+}
+
+// Stop ISP Queue
+void Stop_ISP_Queue (void) {
+
+	Flush_ISP_Queue ();
+	TCCR2B = 0;
+
+}
+
+// Queue Instruction (returns its sequence number for Queued_Answer, only good until ISP_Queue_Size more have been queued)
+uint8_t Queue_Instruction (const uint8_t _Data_1, const uint8_t _Data_2, const uint8_t _Data_3, const uint8_t _Data_4) {
+
+	// Declare Sequence Number
+	const uint8_t _Sequence = ISP_Queue_Head;
+	ISP_Instruction_Type & _Instruction = ISP_Queue [_Sequence % ISP_Queue_Size];
+
+	// Hardware Transports and Digital SPI From Level 0 Up (send straight away, after anything queued at a slower speed)
+	if (ISP_Transport != ISP_BITBANG || ISP_Speed >= 0 || Digital_SPI_Delay < ISP_Queue_Min_Delay) {
+
+		Flush_ISP_Queue ();
+		_Instruction.Data [0] = SPI_Transfer (_Data_1);
+		_Instruction.Data [1] = SPI_Transfer (_Data_2);
+		_Instruction.Data [2] = SPI_Transfer (_Data_3);
+		_Instruction.Data [3] = SPI_Transfer (_Data_4);
+		ISP_Queue_Head = ISP_Queue_Tail = _Sequence + 1;
+
+		// End Function
+		return (_Sequence);
+
+	}
+
+	// Queue Full (wait for a free slot)
+	while ((uint8_t)(_Sequence - ISP_Queue_Tail) >= ISP_Queue_Size);
+
+	// Add Instruction
+	_Instruction.Data [0] = _Data_1;
+	_Instruction.Data [1] = _Data_2;
+	_Instruction.Data [2] = _Data_3;
+	_Instruction.Data [3] = _Data_4;
+	ISP_Queue_Head = _Sequence + 1;
+	TIMSK2 |= (1 << OCIE2A);
+
+	// End Function
+	return (_Sequence);
+
+}
+
+// Queued Answer (what the target sent back on the 4th byte of a queued instruction, waits until it is sent)
+uint8_t Queued_Answer (const uint8_t _Sequence) {
+
+	while ((uint8_t)(ISP_Queue_Tail - _Sequence - 1) >= ISP_Queue_Size);
+
+	// End Function
+	return (ISP_Queue [_Sequence % ISP_Queue_Size].Data [3]);
+
+}
+
+// Set ISP Speed (each level up doubles the hardware clock and moves along Digital_SPI_Delays)
+void Set_ISP_Speed (const int8_t _Speed) {
+
+	// Set Speed
+	ISP_Speed = _Speed;
+
+	// Select Transport
+	switch (ISP_Transport) {
+
+		#if ISP_TRANSPORT == ISP_MSPIM
+		case ISP_MSPIM: {
+			uint32_t _Divider = (((F_CPU / 2 + Target_Clock / ISP_Clock_Fraction - 1) / (Target_Clock / ISP_Clock_Fraction)) << -ISP_Slowest) >> (_Speed - ISP_Slowest);
+			UBRR0 = _Divider > 0 ? _Divider - 1 : 0;
+			break;
+		}
+		#endif
+
+		#if ISP_TRANSPORT == ISP_HWSPI
+		case ISP_HWSPI:
+			Hardware_SPI_Rate (constrain (Hardware_SPI_Base_Rate - _Speed, 0, 6));
+			break;
+		#endif
+
+		default:
+			Digital_SPI_Delay = Digital_SPI_Delays [_Speed - ISP_Slowest];
+			Set_ISP_Queue_Speed ();
+			break;
+
+	}
+
+}
+
+// Program (one instruction, straight away; interrupts stay on, SPI is clocked so a late edge only slows it down)
 uint8_t Program (const uint8_t _Data_1, const uint8_t _Data_2 = 0, const uint8_t _Data_3 = 0, const uint8_t _Data_4 = 0) {
 
-	// Stop Interrupts
-	noInterrupts ();
+	// In Order With Anything Queued
+	Flush_ISP_Queue ();
 
 	// Transfer Data
-	Digital_SPI_Transfer (_Data_1);
+	SPI_Transfer (_Data_1);
 	
 	// Transfer Data
-	Digital_SPI_Transfer (_Data_2);
+	SPI_Transfer (_Data_2);
 
 	// Transfer Data
-	Digital_SPI_Transfer (_Data_3);
+	SPI_Transfer (_Data_3);
 
 	// Transfer Data
-	uint8_t _Data = Digital_SPI_Transfer (_Data_4);
-
-	// Start Interrupts
-	interrupts ();
+	uint8_t _Data = SPI_Transfer (_Data_4);
 
 	// Return Data
 	return _Data;
 	
 }
 
-unsigned long pagesize, pagemask, oldPage, extendedAddress, lowestAddress, highestAddress, bytesWritten;
+unsigned long pagesize, pagemask, extendedAddress, lowestAddress, highestAddress, bytesWritten;
 unsigned int progressBarCount, errors, lineCount;
 bool gotEndOfFile;
 
+// Define Page Image Variables (the page being worked on, and the next one being read ahead, see Next_Page)
+uint8_t Page_Buffers [READ_AHEAD ? 2 : 1][MAX_PAGE_SIZE];
+uint8_t * Page_Buffer = Page_Buffers [0];
+uint8_t * Next_Page_Buffer = Page_Buffers [READ_AHEAD ? 1 : 0];
+unsigned long Buffered_Page;
+uint8_t Loaded_Mask [MAX_PAGE_SIZE / 8];  // offsets in the target's temporary page that hold something other than 0xFF
+uint8_t Covered_Mask [MAX_PAGE_SIZE / 8]; // offsets in Page_Buffer that were supplied by the file
+
+// Define Session Summary
+Session_Stats_Type Stats;
+SdFile Image_Out;
+uint16_t Image_Pages;
+bool Image_OK, Image_Ready;
+uint32_t Image_Map_CRC; // identifies the image in the journal
+
+// Define Flashing Journal Variables (this session's header and records, and the EEPROM bytes waiting to be written)
+Journal_Header_Type Journal;
+uint16_t Journal_Records;
+bool Journal_On;
+Journal_Byte_Type Journal_Queue [Journal_Queue_Size];
+uint8_t Journal_Next, Journal_Queued;
+
+// Define Firmware Container Variables (header of the .pfw file, and whether it is used instead of the .hex file)
+PFW_Header_Type PFW_Header;
+bool PFW_Ready;
+
 // which program instruction writes which fuse
 const byte fuseCommands [4] = { Command_Write_Low_Fuse_Byte, Command_Write_High_Fuse_Byte, Command_Write_Extended_Fuse_Byte, Command_Write_Lock_Byte };
 
 //------------------------------------------------------------------------------
 //      FUNCTIONS
 //------------------------------------------------------------------------------
+// Define LED Pattern Variables (pattern played by the timer 1 interrupt, see blink)
+volatile int LED_Pattern_1 = LED_No, LED_Pattern_2 = LED_No;
+volatile uint8_t LED_Times, LED_Blinks_Left, LED_Message = 0xFF, LED_Progress_Ticks;
+volatile uint16_t LED_Interval, LED_Ticks;
+volatile unsigned long LED_Repeats_Left;  // sequences to go, 0 once finished
+volatile bool LED_Lit;
+
+// LED Timer Interrupt (play one step of the LED pattern)
+ISR (TIMER1_COMPA_vect) {
+
+	// Progress Pulse Finished
+	if (LED_Progress_Ticks && --LED_Progress_Ticks == 0) LED_Green_PORT &= ~(1 << LED_Green_PIN);
+
+	// nothing playing, or not time yet
+	if (LED_Repeats_Left == 0 || --LED_Ticks > 0) return;
+
+	// Toggle LEDs
+	LED_Lit = !LED_Lit;
+	digitalWrite (LED_Pattern_1, LED_Lit);
+	if (LED_Pattern_2 != LED_No) digitalWrite (LED_Pattern_2, LED_Lit);
+	LED_Ticks = LED_Interval;
+
+	// Control for End of Sequence
+	if (LED_Lit || --LED_Blinks_Left > 0) return;
+
+	// wait a second and do it again
+	if (--LED_Repeats_Left > 0) {
+
+		LED_Blinks_Left = LED_Times;
+		LED_Ticks += LED_Gap_Ticks;
+
+	}
+
+}
+
+// Start LED Timer (tick every LED_Tick_MS, timer 1 is otherwise only used for PWM)
+void Start_LED_Timer (void) {
+
+	// Set CTC Mode, F_CPU / 64
+	TCCR1A = 0;
+	TCCR1B = (1 << WGM12) | (1 << CS11) | (1 << CS10);
+
+	// Set Tick
+	OCR1A = F_CPU / 64 / (1000 / LED_Tick_MS) - 1;
+
+	// Enable Compare Interrupt
+	TIMSK1 = (1 << OCIE1A);
+
+}
+
+// Blinking (true while a pattern is still playing)
+bool Blinking (void) {
+
+	// End Function
+	return LED_Repeats_Left > 0;
+
+}
+
+// Blink (returns straight away, the pattern plays in the background and replaces any earlier one)
 void blink(const int whichLED1, const int whichLED2, const byte times = 1, const unsigned long repeat = 1, const unsigned long interval = 200) {
 
-	for (unsigned long i = 0; i < repeat; i++) {
+	// Stop Interrupts
+	noInterrupts ();
+
+	// put out whatever the last pattern left on
+	if (LED_Lit) {
 
-		for (byte j = 0; j < times; j++) {
+		digitalWrite (LED_Pattern_1, LOW);
+		if (LED_Pattern_2 != LED_No) digitalWrite (LED_Pattern_2, LOW);
 
-			digitalWrite(whichLED1, HIGH);
-			if (whichLED2 != -1)
-				digitalWrite(whichLED2, HIGH);
-			delay(interval);
-			digitalWrite(whichLED1, LOW);
-			if (whichLED2 != -1)
-				digitalWrite(whichLED2, LOW);
-			delay(interval);
-		} // end of for loop
-		if (i < (repeat - 1))
-			delay(1000);
-	} // end of repeating the sequence
+	}
+
+	// Set Pattern
+	LED_Pattern_1 = whichLED1;
+	LED_Pattern_2 = whichLED2;
+	LED_Times = LED_Blinks_Left = times;
+	LED_Interval = max (interval / LED_Tick_MS, 1UL);
+	LED_Repeats_Left = times > 0 ? repeat : 0;
+	LED_Ticks = 1;  // first LED on at the next tick
+	LED_Lit = false;
+
+	// Start Interrupts
+	interrupts ();
 
 } // end of blink
 
-// LED Show Progress
+// LED Show Progress (pulse the green LED, the timer puts it out again)
 void LED_Show_Progress (void) {
 
 	// Set Green LED HIGH
 	LED_Green_PORT |= (1 << LED_Green_PIN);
 
-	// Blink Delay
-	delay (100);
-
-	// Set Green LED LOW
-	LED_Green_PORT &= ~(1 << LED_Green_PIN);
+	// Set Pulse Length
+	LED_Progress_Ticks = 100 / LED_Tick_MS;
 
 }
 
 // Show Message
+// Waiting Message (true for the messages loop() shows while it waits for a card, a file or a target, as against the outcome of a session)
+bool Waiting_Message (const uint8_t _Message) {
+
+	// End Function
+	return (_Message == MSG_NO_SD_CARD || _Message == MSG_CANNOT_OPEN_FILE || _Message == MSG_CANNOT_ENTER_PROGRAMMING_MODE || _Message == MSG_CANNOT_FIND_SIGNATURE);
+
+}
+
 void Show_Message(const byte which) {
   
+	// already showing it? let it carry on rather than start again
+	if (which == LED_Message && Blinking ()) return;
+
+	// a session's OK or error plays out before waiting is shown again (the next pass of loop() finds the file gone after a flash, for one)
+	if (Blinking () && Waiting_Message (which) && !Waiting_Message (LED_Message)) return;
+	LED_Message = which;
+
 	// Set All LED Signals LOW
 	PORTC &= 0b11110001;
 
@@ -157,11 +514,12 @@ void Show_Message(const byte which) {
 		case MSG_UNRECOGNIZED_SIGNATURE:			blink(LED_Error, LED_No, 6, 2); 		break;
 		case MSG_BAD_START_ADDRESS:					blink(LED_Error, LED_No, 7, 2); 		break;
 		case MSG_VERIFICATION_ERROR:				blink(LED_Error, LED_No, 8, 2); 		break;
+		case MSG_TARGET_NOT_READY:					blink(LED_Error, LED_No, 9, 2); 		break;
 		case MSG_FLASHED_OK:						blink(LED_Ready, LED_No, 3, 3); 		break;
 
 		case MSG_FLASHED_TEST:						blink(LED_Ready, LED_Working, 3, 1); 	break;
 
-		default:									blink(LED_Error, 10, 10);  			break;
+		default:									blink(LED_Error, LED_No, 10, 10);  	break;
 			
 	}  // end of switch on which message
 	
@@ -192,14 +550,22 @@ void Get_Signature(void) {
 	// Get Signature	
 	for (uint8_t i = 0; i < 3; i++) _Signature[i] = Program(Command_Read_Signature_Byte, 0, i);
 
-	// Search for Signature
-	for (uint16_t j = 0; j < NUMITEMS(Signatures); j++) {
-		
-		// Get MCU Signature
-		memcpy_P(&Current_Signature, &Signatures [j], sizeof Current_Signature);
+	// Search for Signature (binary search over the sorted keys)
+	uint16_t _Low = 0, _High = NUMITEMS(Signature_Keys);
+
+	while (_Low < _High) {
+
+		// Middle Key
+		const uint16_t j = (_Low + _High) / 2;
+
+		// Compare Signature
+		const int _Diff = memcmp_P(_Signature, Signature_Keys [j], sizeof _Signature);
 	
 		// Control Signature
-		if (memcmp(_Signature, Current_Signature.Signature, sizeof _Signature) == 0) {
+		if (_Diff == 0) {
+
+			// Get MCU Signature (only the matching entry is copied)
+			memcpy_P(&Current_Signature, &Signatures [j], sizeof Current_Signature);
 
 			// Set Signature Found		
 			foundSig = j;
@@ -211,6 +577,9 @@ void Get_Signature(void) {
 			return;
 			
 		}
+
+		// Narrow Search
+		if (_Diff < 0) _High = j; else _Low = j + 1;
 		
 	}
 
@@ -225,20 +594,77 @@ void Get_Signature(void) {
 
 
 
-// Digital SPI Start Programming
-bool Digital_SPI_Start_Programming (void) {
+// Start Transport
+void Start_Transport (const uint8_t _Transport) {
 
-	// Set Digital RESET as OUTPUT
-	Digital_Reset_DDR |= (1 << Digital_Reset_PIN);
+	// Select Transport
+	switch (_Transport) {
+
+		#if ISP_TRANSPORT == ISP_MSPIM
+		case ISP_MSPIM:
+			MSPIM_SPI_Start ();
+			SPI_Transfer = MSPIM_SPI_Transfer;
+			break;
+		#endif
+
+		#if ISP_TRANSPORT == ISP_HWSPI
+		case ISP_HWSPI:
+			Hardware_SPI_Start ();
+			SPI_Transfer = Hardware_SPI_Transfer;
+			break;
+		#endif
+
+		default:
+
+			// Set Digital SCK LOW, SCK and MOSI as OUTPUT
+			Digital_SPI::Start ();
+
+			// Start ISP Queue
+			Start_ISP_Queue ();
+
+			// Set Transfer
+			SPI_Transfer = Digital_SPI_Transfer;
+			break;
+
+	}
+
+	// Set Current Transport
+	ISP_Transport = _Transport;
+
+}
+
+// Stop Transport
+void Stop_Transport (void) {
+
+	// Select Transport
+	switch (ISP_Transport) {
+
+		#if ISP_TRANSPORT == ISP_MSPIM
+		case ISP_MSPIM:
+			MSPIM_SPI_Stop ();
+			break;
+		#endif
 
-	// Set Digital SCK LOW
-	Digital_SCK_PORT &= ~(1 << Digital_SCK_PIN);
+		#if ISP_TRANSPORT == ISP_HWSPI
+		case ISP_HWSPI:
+			break;  // bus belongs to the SD card
+		#endif
 
-	// Set Digital SCK as OUTPUT
-	Digital_SCK_DDR |= (1 << Digital_SCK_PIN);
+		default:
 
-	// Set Digital MOSI as OUTPUT
-	Digital_MOSI_DDR |= (1 << Digital_MOSI_PIN);
+			// Send Anything Queued, Stop Timer 2
+			Stop_ISP_Queue ();
+
+			// Set Digital SPI Pins as INPUT, Pull-Up OFF
+			Digital_SPI::Stop ();
+			break;
+
+	}
+
+}
+
+// Sync Target
+bool Sync_Target (const uint8_t _Attempts) {
 
 	// Declare Try Counter
 	uint8_t _Try_Counter = 0;
@@ -249,35 +675,26 @@ bool Digital_SPI_Start_Programming (void) {
 	// we are in sync if we get back programAcknowledge on the third byte
 	do {
 
-		// Regrouping Pause
-		delay (100);
-
-		// Set Digital SCK LOW
-		Digital_SCK_PORT &= ~(1 << Digital_SCK_PIN);
+		// Set Digital SCK LOW (the hardware transports idle low anyway)
+		if (ISP_Transport == ISP_BITBANG) Digital_SPI::SCK::Low ();
 
-		// Set Digital RESET HIGH
-		Digital_Reset_PORT |= (1 << Digital_Reset_PIN);
+		// Pulse Digital RESET
+		Digital_SPI::Pulse_Reset ();
 
-		// Pause
-		delayMicroseconds (10);
-
-		// Set Digital RESET LOW
-		Digital_Reset_PORT &= ~(1 << Digital_Reset_PIN);
-
-		// Pause
-		delay (25);
+		// Pause (at least 20 mS, or what the datasheet asks once we know the chip)
+		delay (foundSig == -1 ? Reset_Settle_MS : Current_Signature.T_Reset);
 
 		// Transfer Data
-		Digital_SPI_Transfer (0xAC);
+		SPI_Transfer (0xAC);
 
 		// Transfer Data
-		Digital_SPI_Transfer (0x53);
+		SPI_Transfer (0x53);
 
 		// Read Data
-		_Control = Digital_SPI_Transfer (0);
+		_Control = SPI_Transfer (0);
 
 		// Transfer Data
-		Digital_SPI_Transfer (0);
+		SPI_Transfer (0);
 
 		// Control for Response	
 		if (_Control != 0x53) {
@@ -286,7 +703,10 @@ bool Digital_SPI_Start_Programming (void) {
 			_Try_Counter++;
 
 			// Control for Try Counter
-			if (_Try_Counter >= 50) return false;
+			if (_Try_Counter >= _Attempts) return false;
+
+			// Regrouping Pause
+			delay (Resync_Pause_MS);
 
 		}
 
@@ -297,114 +717,319 @@ bool Digital_SPI_Start_Programming (void) {
 
 }
 
-// Poll Until Ready
-void Poll_Until_Ready (void) {
-	
-	if (Current_Signature.Timed_Writes) delay (10);  // at least 2 x WD_FLASH which is 4.5 mS
-	else {
-		
-		while ((Program (Command_Poll_Ready) & 1) == 1) {}  // wait till ready
-		
-	}  // end of if
-	
-}
-
-// Write Fuse
-void Write_Fuse (const uint8_t _New_Value, const uint8_t _Instruction) {
+// Find Speed (level 0, or the first slower level the target answers to)
+bool Find_Speed (const uint8_t _Attempts) {
 
-	// Control for New Value	
-	if (_New_Value == 0) return;
+	// Try Each Slower Speed
+	for (int8_t _Speed = 0; _Speed >= ISP_Slowest; _Speed--) {
 
-	// Write Fuse
-	Program (Command_Progam_Enable, _Instruction, 0, _New_Value);
+		// Set Speed
+		Set_ISP_Speed (_Speed);
 
-	// Poll Until Ready
-	Poll_Until_Ready ();
+		// Control for Sync
+		if (Sync_Target (_Speed == 0 ? _Attempts : Slow_SPI_Attempts)) return (true);
 
-}
+	}
 
-// Update Fuses
-bool Update_Fuses (const bool writeIt) {
-  
-	unsigned long addr;
-	unsigned int  len;
-  
-	byte fusenumber = Current_Signature.Fuse_With_Bootloader_Size;
-  
-	// if no fuse, can't change it
-	if (fusenumber == 0xFF) return false;
-	
-	addr = Current_Signature.Flash_Size;
-	len = Current_Signature.Bootloader_Size;
-	
-	if (lowestAddress == 0) {
-		// don't use bootloader
-		Fuses[fusenumber] |= 1;
-	} else {
-		
-		byte newval = 0xFF;
-	
-		if (lowestAddress == (addr - len))
-			newval = 3;
-		else if (lowestAddress == (addr - len * 2))
-			newval = 2;
-		else if (lowestAddress == (addr - len * 4))
-			newval = 1;
-		else if (lowestAddress == (addr - len * 8))
-			newval = 0;
-		else {
-			Show_Message (MSG_BAD_START_ADDRESS);
-			return true;
-		}
-	  
-		if (newval != 0xFF) {
-			newval <<= 1;
-			Fuses[fusenumber] &= ~0x07;   // also program (clear) "boot into bootloader" bit
-			Fuses[fusenumber] |= newval;
-		}  // if valid
-		
-	}  // if not address 0
-  
-	// Write Fuses
-	if (writeIt) Write_Fuse (Fuses[fusenumber], fuseCommands[fusenumber]);
-	
 	// End Function
-	return false;
-	
+	return (false);
+
 }
 
-// Hex Conversion
-bool HEX_Conv (const char * (& pStr), uint8_t & b) {
+// Probe Target (gives the same signature twice, echoing each instruction; only signature reads are sent at a speed that may be too fast, so nothing that starts like programming enable or a write goes out at an untested speed)
+bool Probe_Target (const uint8_t * _Signature) {
 
-	// Check for Hex Digits
-	if (!isxdigit (pStr [0]) || !isxdigit (pStr [1])) {
+	// In Order With Anything Queued
+	Flush_ISP_Queue ();
 
-		// Show Message
-		Show_Message (MSG_INVALID_HEX_DIGITS);
+	// Read Signature Twice
+	for (uint8_t _Pass = 0; _Pass < 2; _Pass++) for (uint8_t i = 0; i < 3; i++) {
 
-		// End Function
-		return true;
-		
-	}
+		// Transfer Data
+		SPI_Transfer (Command_Read_Signature_Byte);
+
+		// Control for Echo
+		if (SPI_Transfer (0) != Command_Read_Signature_Byte) return (false);
 
-	b = *pStr++ - '0';
-	if (b > 9) b -= 7;
-	b <<= 4;
-	uint8_t b1 = *pStr++ - '0';
-	if (b1 > 9) b1 -= 7;
-	b |= b1;
+		// Transfer Data
+		SPI_Transfer (i);
+
+		// Control for Signature
+		if (SPI_Transfer (0) != _Signature [i]) return (false);
+
+	}
 
 	// End Function
-	return false;
-	
+	return (true);
+
 }
 
-// Write Flash
-void Write_Flash (unsigned long addr, const byte data) {
-	
-	byte high = (addr & 1) ? 0x08 : 0;  // set if high byte wanted
-	addr >>= 1;  // turn into word address
-	Program (Command_Load_Program_Memory | high, 0, lowByte (addr), data);
+// Negotiate ISP Speed (lock in one step below the fastest speed that worked)
+bool Negotiate_ISP_Speed (void) {
+
+	// Declare Variables
+	const int8_t _Safe = ISP_Speed;
+	int8_t _Fastest = _Safe;
+	uint8_t _Signature [3];
+
+	// Get Reference Signature
+	for (uint8_t i = 0; i < 3; i++) _Signature [i] = Program (Command_Read_Signature_Byte, 0, i);
+
+	// Probe Faster Speeds
+	while (_Fastest < ISP_Fastest) {
+
+		// Set Speed
+		Set_ISP_Speed (_Fastest + 1);
+
+		// Control for Probe
+		if (!Probe_Target (_Signature)) break;
+
+		// Faster Speed Works
+		_Fastest++;
+
+	}
+
+	// Lock Speed
+	Set_ISP_Speed (_Fastest > _Safe ? _Fastest - 1 : _Safe);
+	ISP_Speed_Locked = true;
+
+	// no probe failed, still in step
+	if (_Fastest == ISP_Fastest) return (true);
+
+	// a failed probe can leave the target out of step, start again
+	if (Sync_Target (50)) return (true);
+
+	// Back to Safe Speed
+	Set_ISP_Speed (_Safe);
+
+	// End Function
+	return (Sync_Target (50));
+
+}
+
+// Digital SPI Start Programming
+bool Digital_SPI_Start_Programming (void) {
+
+	// Set Digital RESET as OUTPUT
+	Digital_SPI::Hold_Reset ();
+
+	// already negotiated with this target? go straight back to that speed
+	if (ISP_Speed_Locked) {
+
+		// Restart Transport
+		Start_Transport (ISP_Transport);
+		Set_ISP_Speed (ISP_Speed);
+
+		// Control for Sync
+		if (Sync_Target (50)) return (true);
+
+		// Release Transport
+		Stop_Transport ();
+		ISP_Speed_Locked = false;
+
+	}
+
+	#if ISP_TRANSPORT != ISP_BITBANG
+
+		// Try Hardware Transport First
+		Start_Transport (ISP_TRANSPORT);
+
+		// Control for Sync
+		if (Find_Speed (Hardware_SPI_Attempts)) return (Negotiate_ISP_Speed ());
+
+		// Release Hardware Transport
+		Stop_Transport ();
+
+	#endif
+
+	// Bit Banged Fallback
+	Start_Transport (ISP_BITBANG);
+
+	// Control for Sync
+	if (!Find_Speed (50)) return (false);
+
+	// End Function
+	return (Negotiate_ISP_Speed ());
+
+}
+
+// Define Busy Work (work to get on with between polls while the target is busy writing, true once there is no more)
+bool (* Busy_Work) (void) = NULL;
+
+// Do Busy Work (one step of Busy_Work, if there is any)
+void Do_Busy_Work (void) {
+
+	if (Busy_Work != NULL && Busy_Work ()) Busy_Work = NULL;
+
+}
+
+// Poll Until Ready (wait for a write of kind _Kind, polling RDY/BSY where the chip has it, false if still busy Poll_Timeout_Factor times the datasheet figure later)
+// Busy_Work is done meanwhile, so the busy times include any step of it that runs past the end of the write
+bool Poll_Until_Ready (const uint8_t _Kind) {
+
+	// Datasheet Figure
+	const uint16_t _US = _Kind == Busy_Flash ? Current_Signature.TWD_Flash : _Kind == Busy_Erase ? Current_Signature.TWD_Erase : Current_Signature.TWD_Fuse;
+
+	// Start Time
+	const uint32_t _Start = micros ();
+
+	if (Current_Signature.Timed_Writes) {
+
+		// Busy Work While Waiting
+		while (Busy_Work != NULL && micros () - _Start < _US) Do_Busy_Work ();
+
+		// Wait the Rest of the Datasheet Figure
+		const uint32_t _Spent = micros () - _Start;
+		if (_Spent < _US) {
+
+			delay ((_US - _Spent) / 1000);
+			delayMicroseconds ((_US - _Spent) % 1000);
+
+		}
+
+	} else {
+		
+		while ((Program (Command_Poll_Ready) & 1) == 1) {
+
+			// Busy Work Between Polls
+			Do_Busy_Work ();
+
+			// Control for Timeout
+			if (micros () - _Start > (uint32_t)_US * Poll_Timeout_Factor) {
+
+				// Count Timeout
+				Stats.Timeouts++;
+
+				// End Function
+				return false;
+
+			}
+
+		}
+		
+	}  // end of if
+
+	// Count Busy Time
+	const uint32_t _Busy = micros () - _Start;
+	Busy_Stats_Type & _Stats = Stats.Busy[_Kind];
+	if (_Stats.Count == 0 || _Busy < _Stats.Shortest) _Stats.Shortest = _Busy;
+	if (_Busy > _Stats.Longest) _Stats.Longest = _Busy;
+	_Stats.Total += _Busy;
+	_Stats.Count++;
+
+	// End Function
+	return true;
+	
+}
+
+// Write Fuse
+void Write_Fuse (const uint8_t _New_Value, const uint8_t _Instruction) {
+
+	// Control for New Value	
+	if (_New_Value == 0) return;
+
+	// Write Fuse
+	Program (Command_Progam_Enable, _Instruction, 0, _New_Value);
+
+	// Poll Until Ready (Write_Flash_Contents reports a timeout)
+	if (!Poll_Until_Ready (Busy_Fuse)) return;
+
+	// CKSEL and CKDIV8 are in the low fuse, the new clock takes effect on the next reset so renegotiate the ISP speed
+	if (_Instruction == Command_Write_Low_Fuse_Byte) {
+
+		// Unlock Speed
+		ISP_Speed_Locked = false;
+
+		// Start Programming
+		Digital_SPI_Start_Programming ();
+
+	}
+
+}
+
+// Define Boot Size (decided by Choose_Input_File, see Update_Fuses)
+uint8_t Boot_Size;
+
+// Decide Boot Size (boot size fuse bits for lowestAddress, 0 to 3, Boot_None or Boot_Bad)
+uint8_t Decide_Boot_Size (void) {
+
+	// Declare Variables
+	const unsigned long addr = Current_Signature.Flash_Size;
+	const unsigned int len = Current_Signature.Bootloader_Size;
+
+	// don't use bootloader
+	if (lowestAddress == 0) return (Boot_None);
+
+	// Boot Sizes
+	if (lowestAddress == (addr - len)) return (3);
+	if (lowestAddress == (addr - len * 2)) return (2);
+	if (lowestAddress == (addr - len * 4)) return (1);
+	if (lowestAddress == (addr - len * 8)) return (0);
+
+	// End Function
+	return (Boot_Bad);
+
+}
+
+// Update Fuses
+bool Update_Fuses (const bool writeIt) {
+  
+	byte fusenumber = Current_Signature.Fuse_With_Bootloader_Size;
+  
+	// if no fuse, can't change it
+	if (fusenumber == 0xFF) return false;
+
+	// Control for Start Address
+	if (Boot_Size == Boot_Bad) {
+		Show_Message (MSG_BAD_START_ADDRESS);
+		return true;
+	}
+	
+	if (Boot_Size == Boot_None) {
+		// don't use bootloader
+		Fuses[fusenumber] |= 1;
+	} else {
+		Fuses[fusenumber] &= ~0x07;   // also program (clear) "boot into bootloader" bit
+		Fuses[fusenumber] |= Boot_Size << 1;
+	}  // if not address 0
+  
+	// Write Fuses
+	if (writeIt) Write_Fuse (Fuses[fusenumber], fuseCommands[fusenumber]);
+	
+	// End Function
+	return false;
+	
+}
+
+// Write PFW Fuses (the fuse and lock bytes the .pfw file asks for, lock byte last)
+void Write_PFW_Fuses (void) {
+
+	// Control for Container
+	if (!PFW_Ready) return;
+
+	// Write Each Requested Fuse That Differs
+	for (uint8_t i = Low_Fuse; i <= Lock_Byte; i++) {
+
+		if ((PFW_Header.Fuse_Mask & Current_Signature.Fuse_Mask & (1 << i)) && PFW_Header.Fuses [i] != Fuses [i]) {
+
+			// Set Fuse
+			Fuses [i] = PFW_Header.Fuses [i];
+
+			// Write Fuse
+			Write_Fuse (Fuses [i], fuseCommands [i]);
+
+		}
+
+	}
+
+}
+
+// Write Flash (queued)
+void Write_Flash (unsigned long addr, const byte data) {
+	
+	byte high = (addr & 1) ? 0x08 : 0;  // set if high byte wanted
+	addr >>= 1;  // turn into word address
+	Queue_Instruction (Command_Load_Program_Memory | high, 0, lowByte (addr), data);
 	
 }
 
@@ -418,7 +1043,7 @@ void Clear_Page (void) {
 }
 
 // Commit Page
-void Commit_Page (unsigned long addr) {
+bool Commit_Page (unsigned long addr) {
   
 	addr >>= 1;  // turn into word address
   
@@ -442,36 +1067,78 @@ void Commit_Page (unsigned long addr) {
 	Program (Command_Write_Program_Memory, highByte (addr), lowByte (addr));
 
 	// poll until ready
-	Poll_Until_Ready ();
+	return (Poll_Until_Ready (Busy_Flash));
+
+}
+
+// Assemble Data (put data into Page_Buffer, handing each completed page to _Flush_Page)
+void Assemble_Data (unsigned long addr, const byte * pData, int length, void (* _Flush_Page) (void)) {
+
+	while (length > 0) {
+
+		unsigned long thisPage = addr & pagemask;
 
-	// clear page
-	Clear_Page();
+		// page changed? hand over old one
+		if (thisPage != Buffered_Page) {
+
+			// Flush Page
+			if (Buffered_Page != NO_PAGE) _Flush_Page ();
+
+			// Start New Page
+			Buffered_Page = thisPage;
+			memset (Page_Buffer, 0xFF, pagesize);
+			memset (Covered_Mask, 0, sizeof Covered_Mask);
+
+		}
+
+		// copy as much as fits in this page
+		uint16_t _Offset = addr - thisPage;
+		uint16_t _Count = min ((unsigned long) length, pagesize - _Offset);
+		memcpy (&Page_Buffer [_Offset], pData, _Count);
+		for (uint16_t i = _Offset; i < _Offset + _Count; i++) Covered_Mask [i >> 3] |= (1 << (i & 7));
+
+		// Advance
+		addr += _Count;
+		pData += _Count;
+		length -= _Count;
+
+	}
 
 }
 
-// Write Data
-void Write_Data (const unsigned long addr, const byte * pData, const int length) {
-	
-	// write each byte
-	for (int i = 0; i < length; i++) {
-		
-		unsigned long thisPage = (addr + i) & pagemask;
-		
-		// page changed? commit old one
-		if (thisPage != oldPage && oldPage != 0xFFFFFFFF) Commit_Page (oldPage);
-		
-		// now this is the current page
-		oldPage = thisPage;
-		
-		// put byte into work buffer
-		Write_Flash (addr + i, pData [i]);
-		
-	} 
-	
+// Load Page (the flash was erased, so 0xFF only needs loading where the temporary page may still hold something else)
+void Load_Page (void) {
+
+	for (uint16_t i = 0; i < pagesize; i++) {
+
+		uint8_t _Data = Page_Buffer [i];
+		uint8_t _Mask = (1 << (i & 7));
+
+		// Track Loaded Bytes
+		if (_Data != 0xFF) Loaded_Mask [i >> 3] |= _Mask;
+		else if (Loaded_Mask [i >> 3] & _Mask) Loaded_Mask [i >> 3] &= ~_Mask;
+		else continue;  // already 0xFF
+
+		// Load Byte
+		Queue_Instruction (Command_Load_Program_Memory | ((i & 1) ? 0x08 : 0), 0, i >> 1, _Data);
+
+	}
+
 }
 
-// Read Flash
-uint8_t Read_Flash (unsigned long addr) {
+// Blank Page (Page_Buffer holds nothing but 0xFF, ie. what the erased flash has already)
+bool Blank_Page (void) {
+
+	// Check Each Byte
+	for (uint16_t i = 0; i < pagesize; i++) if (Page_Buffer [i] != 0xFF) return (false);
+
+	// End Function
+	return (true);
+
+}
+
+// Queue Read Flash (returns the sequence number to pass to Queued_Answer)
+uint8_t Queue_Read_Flash (unsigned long addr) {
 	
 	uint8_t high = (addr & 1) ? 0x08 : 0;  // set if high uint8_t wanted
 	addr >>= 1;  // turn into word address
@@ -481,190 +1148,1415 @@ uint8_t Read_Flash (unsigned long addr) {
 	
 	if (MSB != lastAddressMSB) {
 		
-		Program (Command_Load_Extended_Address_Byte, 0, MSB);
+		Queue_Instruction (Command_Load_Extended_Address_Byte, 0, MSB, 0);
 		lastAddressMSB = MSB;
 		
 	}  // end if different MSB
 
-	return Program (Command_Read_Program_Memory | high, highByte (addr), lowByte (addr));
+	return Queue_Instruction (Command_Read_Program_Memory | high, highByte (addr), lowByte (addr), 0);
 	
 }
 
-// Verify Data
-void Verify_Data (const unsigned long addr, const byte * pData, const int length) {
-  
-	// check each byte
-	for (int i = 0; i < length; i++) {
-		
-		unsigned long thisPage = (addr + i) & pagemask;
-		
-		// page changed? show progress
-		if (thisPage != oldPage && oldPage != 0xFFFFFFFF) LED_Show_Progress ();
-		
-		// now this is the current page
-		oldPage = thisPage;
-	  
-		byte found = Read_Flash (addr + i);
-		byte expected = pData [i];
-		
-		if (found != expected) errors++;
-		
-	}  // end of for
-	
+// Read Flash
+uint8_t Read_Flash (unsigned long addr) {
+
+	// End Function
+	return (Queued_Answer (Queue_Read_Flash (addr)));
+
 }
 
-// Process Line
-bool Process_Line (const char * pLine, const byte action) {
+// Page Differences (number of bytes supplied by the file that the flash does not hold, reads queued up to ISP_Reads_Ahead ahead of the comparisons)
+uint16_t Page_Differences (const unsigned long addr) {
 
-	// Check for : Character
-	if (*pLine++ != ':') {
+	// Declare Reads (sequence numbers, by offset % ISP_Reads_Ahead) and Counters
+	uint8_t _Reads [ISP_Reads_Ahead];
+	uint16_t _Queued = 0;
+	uint16_t _Count = 0;
 
-		// Show Message
-		Show_Message (MSG_LINE_DOES_NOT_START_WITH_COLON);
-		
-		// End Function
-		return true;
+	// check each supplied byte
+	for (uint16_t i = 0; i < pagesize; i++) {
+
+		// Queue Reads Ahead
+		for (; _Queued < pagesize && _Queued < i + ISP_Reads_Ahead; _Queued++) if (Covered_Mask [_Queued >> 3] & (1 << (_Queued & 7))) _Reads [_Queued % ISP_Reads_Ahead] = Queue_Read_Flash (addr + _Queued);
+
+		// Compare
+		if ((Covered_Mask [i >> 3] & (1 << (i & 7))) && Queued_Answer (_Reads [i % ISP_Reads_Ahead]) != Page_Buffer [i]) _Count++;
 
 	}
 
-	// Declare Buffer
-	uint8_t _HEX_Buffer[40];
+	// End Function
+	return _Count;
 
-	// Declare Variables
-	uint8_t _Bytes_In_Line = 0;
+}
 
-	// Show LED Progress
-	if (action == Action_Check_File) if (lineCount++ % 40 == 0) LED_Show_Progress ();
+// Write Page (load and commit Page_Buffer, reading it back if Verify_On_Write)
+void Write_Page (const unsigned long addr) {
 
-	// Convert to Hex
-	while (isxdigit (*pLine)) {
-		
-		// can't fit?
-		if (_Bytes_In_Line >= 40) {
-			
-			// Show Message
-			Show_Message (MSG_LINE_TOO_LONG);
-			
-			// End Function
-			return true;
+	// nothing to write
+	if (Blank_Page ()) {
 
-		}
+		// Count Skipped Page
+		Stats.Pages_Skipped++;
+
+		// End Function
+		return;
 
-		// Convert Hex
-		if (HEX_Conv (pLine, _HEX_Buffer [_Bytes_In_Line++])) return true;
-		
 	}
 
-	// Check for Short Line
-	if (_Bytes_In_Line < 5) {
-		
-		// Show Message
-		Show_Message (MSG_LINE_TOO_SHORT);
-		
+	// target stopped answering? don't spend a timeout on every page
+	if (Stats.Timeouts > 0) {
+
+		// Count Failed Page
+		Stats.Pages_Failed++;
+
 		// End Function
-		return true;
+		return;
 
 	}
 
-	// Declare Sum Check
-	uint8_t _Sum_Check = 0;
+	// Try Each Attempt
+	for (uint8_t _Attempt = 1;; _Attempt++) {
 
-	// Check Sum Check
-	for (uint8_t i = 0; i < (_Bytes_In_Line - 1); i++) _Sum_Check += _HEX_Buffer [i];
+		// Load Page (a retry loads every byte that is not 0xFF again)
+		Load_Page ();
 
-	// 2's complement
-	_Sum_Check = ~_Sum_Check + 1;
-  
-	// check sumcheck
-	if (_Sum_Check != _HEX_Buffer [_Bytes_In_Line - 1]) {
+		// Commit Page
+		if (!Commit_Page (addr)) {
 
-		// Show Message
-		Show_Message (MSG_BAD_SUMCHECK);
+			// Count Failed Page
+			Stats.Pages_Failed++;
 
-		// End Function
-		return true;
+			// End Function
+			return;
 
-	}
-  
-	// length of data (eg. how much to write to memory)
-	uint8_t _Len = _HEX_Buffer [0];
-  
-	// the data length should be the number of bytes, less
-	//   length / address (2) / transaction type / sumcheck
-	if (_Len != (_Bytes_In_Line - 5)) {
+		}
 
-		// Show Message
-		Show_Message (MSG_LINE_NOT_EXPECTED_LENGTH);
+		// Control for Read Back
+		if (!Verify_On_Write || Page_Differences (addr) == 0) {
 
-		// End Function
-		return true;
+			// Count Written Page
+			Stats.Pages_Written++;
+
+			// End Function
+			return;
+
+		}
+
+		// Out of Attempts
+		if (_Attempt >= Page_Write_Attempts) {
+
+			// Count Failed Page
+			Stats.Pages_Failed++;
+
+			// Count Error
+			errors++;
+
+			// End Function
+			return;
+
+		}
+
+		// Count Retried Page
+		Stats.Pages_Retried++;
+
+	}
+
+}
+
+// Write Buffered Page
+void Write_Buffered_Page (void) {
+
+	// Write Page
+	Write_Page (Buffered_Page);
+
+}
+
+// Write Data
+void Write_Data (const unsigned long addr, const byte * pData, const int length) {
+
+	// assemble data into pages, committing each one as it is completed
+	Assemble_Data (addr, pData, length, Write_Buffered_Page);
+
+}
+
+// Verify Page (compare Page_Buffer with the flash, where the file supplied the data)
+void Verify_Page (const unsigned long addr) {
+
+	// never written, still erased
+	if (Blank_Page ()) return;
+
+	// show progress
+	LED_Show_Progress ();
+
+	// check each supplied byte
+	errors += Page_Differences (addr);
+
+}
+
+// Verify Buffered Page
+void Verify_Buffered_Page (void) {
+
+	// Verify Page
+	Verify_Page (Buffered_Page);
+
+}
+
+// Verify Data
+void Verify_Data (const unsigned long addr, const byte * pData, const int length) {
+
+	// assemble data into pages, verifying each one as it is completed
+	Assemble_Data (addr, pData, length, Verify_Buffered_Page);
+
+}
+
+// Compare Page (compare the flash with Page_Buffer as a write would leave it, stopping at the first difference)
+void Compare_Page (const unsigned long addr) {
+
+	// already know the target needs writing
+	if (errors > 0) return;
+
+	// show progress
+	LED_Show_Progress ();
+
+	// check every byte, 0xFF wherever the file has no data
+	for (uint16_t i = 0; i < pagesize; i++) {
+
+		// Control for Difference
+		if (Read_Flash (addr + i) != Page_Buffer [i]) {
+
+			// Count Difference
+			errors++;
+
+			// End Function
+			return;
+
+		}
+
+	}
+
+	// Count Matched Page
+	Stats.Pages_Matched++;
+
+}
+
+// Define Compare Variable (flash below this is accounted for by the compare: the image pages and the blank ones between them)
+unsigned long Compared_To;
+
+// Compare Blank (the flash from Compared_To up to _To is not in the image, so it has to read 0xFF: a stale boot loader or the end of a longer application would not)
+void Compare_Blank (const unsigned long _To) {
+
+	// pages out of order, can't tell what lies between them
+	if (_To < Compared_To) errors++;
+
+	// Check Each Byte
+	for (unsigned long _Address = Compared_To; _Address < _To && errors == 0; _Address++) {
+
+		// show progress
+		if ((_Address & ~pagemask) == 0) LED_Show_Progress ();
+
+		// Control for Difference
+		if (Read_Flash (_Address) != 0xFF) errors++;
+
+	}
+
+	// Set Variable
+	Compared_To = _To;
+
+}
+
+// Worth Comparing (reading a page takes about half as long as writing and verifying one, so only while no more than half the flash is outside the image)
+bool Worth_Comparing (const uint16_t _Image_Pages) {
+
+	// End Function
+	return (Current_Signature.Flash_Size / pagesize <= 2UL * _Image_Pages);
+
+}
+
+// Page CRC
+uint16_t Page_CRC (void) {
+
+	// Declare CRC
+	uint16_t _CRC = 0xFFFF;
+
+	// Calculate CRC
+	for (uint16_t i = 0; i < pagesize; i++) _CRC = _crc_ccitt_update (_CRC, Page_Buffer [i]);
+
+	// End Function
+	return _CRC;
+
+}
+
+// CRC-32 Update (start with 0xFFFFFFFF and invert the result)
+uint32_t CRC32_Update (uint32_t _CRC, const void * _Data, uint16_t _Length) {
+
+	// Declare Pointer
+	const uint8_t * _Pointer = (const uint8_t *) _Data;
+
+	// Calculate CRC (a nibble at a time)
+	while (_Length--) {
+
+		_CRC = pgm_read_dword (&CRC32_Nibble [(_CRC ^ *_Pointer) & 0x0F]) ^ (_CRC >> 4);
+		_CRC = pgm_read_dword (&CRC32_Nibble [(_CRC ^ (*_Pointer++ >> 4)) & 0x0F]) ^ (_CRC >> 4);
+
+	}
+
+	// End Function
+	return _CRC;
+
+}
+
+// Start Image
+void Start_Image (void) {
+
+	// Declare Placeholder Header
+	Image_Header_Type _Header = {};
+
+	// Clear Variables
+	Image_Ready = false;
+	Image_Pages = 0;
+	Image_Map_CRC = 0xFFFFFFFF;
+
+	// Create Image File
+	Image_OK = pagesize <= MAX_PAGE_SIZE && Image_Out.open (Image_Name, O_RDWR | O_CREAT | O_TRUNC) && Image_Out.write (&_Header, sizeof _Header) == (int) sizeof _Header;
+
+}
+
+// Drop Image (the check stopped on an error)
+void Drop_Image (void) {
+
+	// Close Image File
+	Image_Out.close ();
+
+	// don't leave part of an image on the card
+	sd.remove (Image_Name);
+
+	// Clear Variable
+	Image_OK = false;
+
+}
+
+// Flush Image Page
+void Flush_Image_Page (void) {
+
+	// Control for Page
+	if (!Image_OK || Buffered_Page == NO_PAGE) return;
+
+	// Declare Page Map Entry
+	Image_Page_Type _Page = { (uint32_t) Buffered_Page, Page_CRC () };
+
+	// Add to Page Map CRC
+	Image_Map_CRC = CRC32_Update (Image_Map_CRC, &_Page.Address, sizeof _Page.Address);
+	Image_Map_CRC = CRC32_Update (Image_Map_CRC, &_Page.CRC, sizeof _Page.CRC);
+
+	// Write Page Map Entry and Page
+	if (Image_Out.write (&_Page, sizeof _Page) != (int) sizeof _Page || Image_Out.write (Page_Buffer, pagesize) != (int) pagesize) Image_OK = false;
+
+	// Increment Page Count
+	Image_Pages++;
+
+}
+
+// Image Data
+void Image_Data (const unsigned long addr, const byte * pData, const int length) {
+
+	// going back to an earlier page would put it in the image twice
+	if (Buffered_Page != NO_PAGE && (addr & pagemask) < Buffered_Page) Image_OK = false;
+
+	// assemble data into pages for the image file
+	if (Image_OK) Assemble_Data (addr, pData, length, Flush_Image_Page);
+
+}
+
+// Finish Image
+void Finish_Image (void) {
+
+	// Flush Last Page
+	Flush_Image_Page ();
+
+	// Declare Header
+	Image_Header_Type _Header = { IMAGE_MAGIC, (uint32_t) pagesize, Image_Pages, (uint32_t) lowestAddress, (uint32_t) highestAddress, (uint32_t) bytesWritten };
+
+	// Write Header
+	Image_OK = Image_OK && Image_Out.seekSet (0) && Image_Out.write (&_Header, sizeof _Header) == (int) sizeof _Header;
+
+	// Close Image File
+	Image_Ready = Image_Out.close () && Image_OK;
+
+	// fall back to parsing the .hex file
+	if (!Image_Ready) sd.remove (Image_Name);
+
+}
+
+// Journal Header Address
+int Journal_Header_At (const uint8_t _Slot) {
+
+	// End Function
+	return (_Slot * sizeof (Journal_Header_Type));
+
+}
+
+// Journal Record Address
+int Journal_Record_At (const uint16_t _Slot) {
+
+	// End Function
+	return (Journal_Headers * sizeof (Journal_Header_Type) + (_Slot % Journal_Slots) * sizeof (Journal_Record_Type));
+
+}
+
+// Latest Journal (the session where the run of sequence numbers breaks, returns its slot)
+uint8_t Latest_Journal (Journal_Header_Type & _Header) {
+
+	// Read First Header
+	EEPROM.get (Journal_Header_At (0), _Header);
+
+	// Follow Sequence
+	for (uint8_t _Slot = 1; _Slot < Journal_Headers; _Slot++) {
+
+		// Read Next Header
+		Journal_Header_Type _Next;
+		EEPROM.get (Journal_Header_At (_Slot), _Next);
+
+		// Control for Break
+		if (_Next.Sequence != (uint8_t) (_Header.Sequence + 1)) return (_Slot - 1);
+
+		// Next Header
+		_Header = _Next;
+
+	}
+
+	// End Function
+	return (Journal_Headers - 1);
+
+}
+
+// Count Journal Records (_Done is set if the last one says the session finished)
+uint16_t Count_Journal_Records (const Journal_Header_Type & _Header, bool & _Done) {
+
+	// Declare Variables
+	uint16_t _Count = 0;
+	_Done = false;
+
+	// Follow Records
+	while (_Count < Journal_Slots && !_Done) {
+
+		// Read Record
+		Journal_Record_Type _Record;
+		EEPROM.get (Journal_Record_At (_Header.Ring_Start + _Count), _Record);
+
+		// Control for Record
+		if (_Record.Sequence != _Header.Sequence || (_Record.Chunks != Journal_Done && _Record.Chunks != _Count + 1)) break;
+
+		// Count Record
+		_Done = _Record.Chunks == Journal_Done;
+		_Count++;
+
+	}
+
+	// End Function
+	return (_Count);
+
+}
+
+// Write Journal Byte (the next queued one, if any)
+void Write_Journal_Byte (void) {
+
+	// Control for Queue
+	if (Journal_Queued == 0) return;
+
+	// Write Byte
+	EEPROM.update (Journal_Queue [Journal_Next].Address, Journal_Queue [Journal_Next].Value);
+
+	// Next Byte
+	Journal_Next = (Journal_Next + 1) % Journal_Queue_Size;
+	Journal_Queued--;
+
+}
+
+// Queue Journal (waits only if the queue is full)
+void Queue_Journal (const int _Address, const void * _Data, const uint8_t _Length) {
+
+	// Declare Pointer
+	const uint8_t * _Pointer = (const uint8_t *) _Data;
+
+	// Queue Bytes
+	for (uint8_t i = 0; i < _Length; i++) {
+
+		// Make Room
+		if (Journal_Queued == Journal_Queue_Size) Write_Journal_Byte ();
+
+		// Add Byte
+		Journal_Byte_Type & _Last = Journal_Queue [(Journal_Next + Journal_Queued) % Journal_Queue_Size];
+		_Last.Address = _Address + i;
+		_Last.Value = _Pointer [i];
+		Journal_Queued++;
+
+	}
+
+}
+
+// Add Journal Record
+void Add_Journal_Record (const uint8_t _Chunks) {
+
+	// Declare Record
+	const Journal_Record_Type _Record = { _Chunks, Journal.Sequence };
+
+	// Queue Record
+	Queue_Journal (Journal_Record_At (Journal.Ring_Start + Journal_Records), &_Record, sizeof _Record);
+	Journal_Records++;
+
+}
+
+// Start Journal (a new session after the latest, its records after the ones that session wrote)
+void Start_Journal (void) {
+
+	// Declare Variables
+	Journal_Header_Type _Last;
+	bool _Done;
+	const uint8_t _Slot = (Latest_Journal (_Last) + 1) % Journal_Headers;
+
+	// Set Header
+	Journal.Map_CRC = Image_Map_CRC;
+	memcpy (Journal.Signature, Current_Signature.Signature, sizeof Journal.Signature);
+	Journal.Ring_Start = (_Last.Ring_Start + Count_Journal_Records (_Last, _Done)) % Journal_Slots;
+	Journal.Sequence = _Last.Sequence + 1;
+	Journal_Records = 0;
+
+	// Queue Header
+	Queue_Journal (Journal_Header_At (_Slot), &Journal, sizeof Journal);
+
+}
+
+// Journal Progress (the first _Pages pages of the image are on the target)
+void Journal_Progress (const uint16_t _Pages) {
+
+	// Add Record
+	if (Journal_On && _Pages % Journal_Pages == 0 && errors == 0 && Stats.Timeouts == 0) Add_Journal_Record (_Pages / Journal_Pages);
+
+	// Write a Queued Byte (the last has long finished, a page takes longer)
+	Write_Journal_Byte ();
+
+}
+
+// Flush Journal (write whatever is still queued, before the next session)
+void Flush_Journal (void) {
+
+	// Write Bytes
+	while (Journal_Queued > 0) Write_Journal_Byte ();
+
+}
+
+// Flash Page CRC (as Page_CRC, _Blank is set if the page is all 0xFF)
+uint16_t Flash_Page_CRC (const unsigned long addr, bool & _Blank) {
+
+	// Declare Variables
+	uint8_t _Reads [ISP_Reads_Ahead];  // sequence numbers, by offset % ISP_Reads_Ahead
+	uint16_t _Queued = 0;
+	uint16_t _CRC = 0xFFFF;
+	_Blank = true;
+
+	// Read Page
+	for (uint16_t i = 0; i < pagesize; i++) {
+
+		// Read Ahead
+		for (; _Queued < pagesize && _Queued < i + ISP_Reads_Ahead; _Queued++) _Reads [_Queued % ISP_Reads_Ahead] = Queue_Read_Flash (addr + _Queued);
+
+		// Add Byte
+		const uint8_t _Data = Queued_Answer (_Reads [i % ISP_Reads_Ahead]);
+		_CRC = _crc_ccitt_update (_CRC, _Data);
+		if (_Data != 0xFF) _Blank = false;
+
+	}
+
+	// End Function
+	return (_CRC);
+
+}
+
+// Resume Pages (pages at the start of the image a session cut short left on the target, 0 to start again from the erase)
+// the latest journal entry has to be for this image and chip, and every page it records has to read back with the CRC in the page map
+// so may the pages up to the next record, the first that does not has to be blank (half written, only a chip erase would clear it)
+uint16_t Resume_Pages (void) {
+
+	// Drop Bytes Left by a Session that Stopped on an Error
+	Journal_Queued = 0;
+
+	// Control for Journal
+	if (!Journal_On) return (0);
+
+	// Read Latest Session
+	bool _Done;
+	Latest_Journal (Journal);
+	Journal_Records = Count_Journal_Records (Journal, _Done);
+
+	// Control for Session
+	if (_Done || Journal_Records == 0 || Journal.Map_CRC != Image_Map_CRC || memcmp (Journal.Signature, Current_Signature.Signature, sizeof Journal.Signature) != 0) return (0);
+
+	// Declare Variables
+	SdFile _Image;
+	Image_Header_Type _Header;
+	Image_Page_Type _Page;
+
+	// Open Image
+	if (!_Image.open (Image_Name, O_READ) || _Image.read (&_Header, sizeof _Header) != (int) sizeof _Header) {
+
+		// Close Image
+		_Image.close ();
+
+		// End Function
+		return (0);
+
+	}
+
+	// Check Pages
+	const uint16_t _Recorded = Journal_Records * Journal_Pages;
+	uint16_t _Pages = 0;
+	for (; _Pages < _Header.Page_Count && _Pages < _Recorded + Journal_Pages; _Pages++) {
+
+		// page map entry only, the page data is skipped
+		if (!_Image.seekSet (sizeof _Header + _Pages * (sizeof _Page + pagesize)) || _Image.read (&_Page, sizeof _Page) != (int) sizeof _Page) {
+
+			// Start Again
+			_Pages = 0;
+			break;
+
+		}
+
+		// read back whole by compare before write
+		if (_Pages < Stats.Pages_Matched) continue;
+
+		// Control for Page
+		bool _Blank;
+		if (Flash_Page_CRC (_Page.Address, _Blank) == _Page.CRC) continue;
+
+		// Start Again (a recorded page is wrong, or this one is half written)
+		if (_Pages < _Recorded || !_Blank) _Pages = 0;
+		break;
+
+	}
+
+	// Close Image
+	_Image.close ();
+
+	// the records go up in ones, catch up with any pages found past the last
+	while (_Pages > 0 && Journal_Records < _Pages / Journal_Pages) Add_Journal_Record (Journal_Records + 1);
+
+	// End Function
+	return (_Pages);
+
+}
+
+// Define HEX Decoder Variables (record being decoded, carried over from one chunk of the file to the next)
+uint8_t HEX_Buffer [HEX_Record_Size];
+uint8_t Bytes_In_Line, Sum_Check, HEX_High_Nibble, HEX_State;
+
+// Process Record
+bool Process_Record (const byte action) {
+
+	// Show LED Progress
+	if (action == Action_Check_File) if (lineCount++ % 40 == 0) LED_Show_Progress ();
+
+	// Check for Short Line
+	if (Bytes_In_Line < 5) {
+		
+		// Show Message
+		Show_Message (MSG_LINE_TOO_SHORT);
+		
+		// End Function
+		return true;
+
+	}
+
+	// check sumcheck (2's complement of the other bytes, so they all add up to zero)
+	if (Sum_Check != 0) {
+
+		// Show Message
+		Show_Message (MSG_BAD_SUMCHECK);
+
+		// End Function
+		return true;
+
+	}
+  
+	// length of data (eg. how much to write to memory)
+	uint8_t _Len = HEX_Buffer [0];
+  
+	// the data length should be the number of bytes, less
+	//   length / address (2) / transaction type / sumcheck
+	if (_Len != (Bytes_In_Line - 5)) {
+
+		// Show Message
+		Show_Message (MSG_LINE_NOT_EXPECTED_LENGTH);
+
+		// End Function
+		return true;
+
+	}
+	
+	// two bytes of address
+	uint8_t _Address_High = HEX_Buffer [1];
+	uint8_t _Address_Low = HEX_Buffer [2];
+	uint16_t _Address = _Address_Low | (_Address_High << 8);
+
+	// Record Type
+	uint8_t _Record_Type = HEX_Buffer [3];
+
+	// Switch Record Type
+	switch (_Record_Type) {
+	
+		// Data Record
+		case HEX_Data_Record: {
+
+			lowestAddress  = min (lowestAddress, _Address + extendedAddress);
+			highestAddress = max (lowestAddress, _Address + extendedAddress + _Len - 1);
+			bytesWritten += _Len;
+	
+			switch (action) {
+				case Action_Check_File:  // we do the checks anyway, just build the page image
+					Image_Data (_Address + extendedAddress, &HEX_Buffer [4], _Len);
+					break;
+		  
+				case Action_Verify_Flash:
+					Verify_Data (_Address + extendedAddress, &HEX_Buffer [4], _Len);
+					break;
+		
+				case Action_Write_To_Flash:
+					Write_Data (_Address + extendedAddress, &HEX_Buffer [4], _Len);
+					break;
+
+					
+			} // end of switch on action
+			break;
+
+		}
+  
+		// end of data
+		case HEX_End_Of_File: {
+
+			// Set End Of File
+			gotEndOfFile = true;
+			
+			// End Function
+			break;
+
+		}
+  
+		// we are setting the high-order byte of the address
+		case HEX_Extended_Segment_Address_Record: {
+
+			extendedAddress = ((unsigned long) HEX_Buffer [4]) << 12;
+			break;
+
+		}
+
+		// Default		
+		default: {
+			
+			// Show Message
+			Show_Message (MSG_UNKNOWN_RECORD_TYPE);
+			
+			// End Function
+			return true;
+
+		}
+
+	}
+
+	// End Function
+	return false;
+
+}
+
+// Decode HEX Character (feed one character of the .hex file to the record decoder)
+bool Decode_HEX_Char (const char c, const byte action) {
+
+	// end of line? then the record is complete (empty lines are ignored)
+	if (c == '\n' || c == '\r') {
+
+		// Declare State
+		uint8_t _State = HEX_State;
+
+		// Next Line
+		HEX_State = HEX_State_Line_Start;
+
+		// Empty Line
+		if (_State == HEX_State_Line_Start) return false;
+
+		// Odd Number of Digits
+		if (_State == HEX_State_Low_Nibble) {
+
+			// Show Message
+			Show_Message (MSG_INVALID_HEX_DIGITS);
+
+			// End Function
+			return true;
+
+		}
+
+		// Process Record
+		return Process_Record (action);
+
+	}
+
+	// Get Nibble
+	uint8_t _Nibble = pgm_read_byte (&HEX_Nibble [(uint8_t) c]);
+
+	// Switch State
+	switch (HEX_State) {
+
+		// Check for : Character
+		case HEX_State_Line_Start: {
+
+			if (c != ':') {
+
+				// Show Message
+				Show_Message (MSG_LINE_DOES_NOT_START_WITH_COLON);
+
+				// End Function
+				return true;
+
+			}
+
+			// Start Record
+			Bytes_In_Line = 0;
+			Sum_Check = 0;
+			HEX_State = HEX_State_High_Nibble;
+			break;
+
+		}
+
+		// First Digit of a Byte
+		case HEX_State_High_Nibble: {
+
+			// rest of the line isn't ours
+			if (_Nibble == 0xFF) {
+
+				HEX_State = HEX_State_Line_Trailer;
+				break;
+
+			}
+
+			// can't fit?
+			if (Bytes_In_Line >= HEX_Record_Size) {
+
+				// Show Message
+				Show_Message (MSG_LINE_TOO_LONG);
+
+				// End Function
+				return true;
+
+			}
+
+			// Set High Nibble
+			HEX_High_Nibble = _Nibble;
+			HEX_State = HEX_State_Low_Nibble;
+			break;
+
+		}
+
+		// Second Digit of a Byte
+		case HEX_State_Low_Nibble: {
+
+			// Check for Hex Digits
+			if (_Nibble == 0xFF) {
+
+				// Show Message
+				Show_Message (MSG_INVALID_HEX_DIGITS);
+
+				// End Function
+				return true;
+
+			}
+
+			// Convert Hex (summing as we go)
+			HEX_Buffer [Bytes_In_Line] = (HEX_High_Nibble << 4) | _Nibble;
+			Sum_Check += HEX_Buffer [Bytes_In_Line++];
+			HEX_State = HEX_State_High_Nibble;
+			break;
+
+		}
+
+	}
+
+	// End Function
+	return false;
+
+}
+
+// Parse Hex File (read the file a chunk at a time and decode records straight out of each chunk)
+bool Parse_Hex_File (const char * _File_Name, const uint8_t _Action) {
+
+	// Declare Variables
+	SdFile _HEX;
+	uint8_t _Chunk [HEX_Chunk_Size];
+	int _Count;
+
+	// check for open error
+	if (!_HEX.open (_File_Name, O_READ)) {
+
+		// Show Message
+		Show_Message(MSG_CANNOT_OPEN_FILE);
+
+		// Set Burn Enable Pin LOW
+		Burn_Enable_PORT &= ~(1 << Burn_Enable_PIN);
+
+		// Set Power Done Pin HIGH
+		Power_Done_PORT |= (1 << Power_Done_PIN);
+		
+		// Sleep Delay
+		delay(500);
+
+		// End Function
+		return true;
+
+	}
+
+	// Build Page Image (now that there is a file to build it from)
+	if (_Action == Action_Check_File) Start_Image ();
+
+	// Start at a Line
+	HEX_State = HEX_State_Line_Start;
+
+	// Read Hex File (a record may carry on into the next chunk)
+	while ((_Count = _HEX.read (_Chunk, sizeof _Chunk)) > 0) {
+
+		// Decode Each Character
+		for (int i = 0; i < _Count; i++) {
+
+			// Control for Error
+			if (Decode_HEX_Char (_Chunk [i], _Action)) {
+
+				// Close File
+				_HEX.close ();
+
+				// End Function
+				return true;
+
+			}
+
+		}
+
+	}
+
+	// Close File
+	_HEX.close ();
+
+	// Read Error
+	if (_Count < 0) {
+
+		// Show Message
+		Show_Message (MSG_CANNOT_OPEN_FILE);
+
+		// End Function
+		return true;
+
+	}
+
+	// finish off a last line without a line ending
+	if (Decode_HEX_Char ('\n', _Action)) return true;
+
+	// Control for End of File
+	if (!gotEndOfFile) {
+
+		// Show Message
+		Show_Message (MSG_NO_END_OF_FILE_RECORD);
+
+		// Set Burn Enable Pin LOW
+		Burn_Enable_PORT &= ~(1 << Burn_Enable_PIN);
+
+		// Set Power Done Pin HIGH
+		Power_Done_PORT |= (1 << Power_Done_PIN);
+		
+		// Sleep Delay
+		delay(200);
+
+		// End Function		
+		return true;
+
+	}
+
+	// End Function
+	return false;
+
+}
+
+// Define Read Ahead Variables (the page image and .pfw files are read one page ahead: Next_Page hands over a page and starts on
+// the next, and whatever of that is left to read while the target is busy writing the page is read then, a chunk between polls)
+SdFile * Ahead_File;			// being read ahead, NULL for none
+union {
+	Image_Page_Type Image;
+	PFW_Page_Type PFW;
+} Ahead_Entry;					// page map entry of the next page
+uint8_t Ahead_Entry_Size;		// sizeof the map entry type
+uint16_t Ahead_Pages_Left;		// including the one being read
+uint16_t Ahead_Done;			// bytes of the next map entry and page read
+bool Ahead_Failed;				// read error
+
+// Read Ahead (up to _Limit more bytes of the next page, true once it is all there or the read failed)
+bool Read_Ahead (uint16_t _Limit) {
+
+	// Map Entry and Page
+	const uint16_t _Total = Ahead_Entry_Size + pagesize;
+
+	while (Ahead_Done < _Total && _Limit > 0 && !Ahead_Failed) {
+
+		// Entry First, then Page
+		uint8_t * _Into = Ahead_Done < Ahead_Entry_Size ? (uint8_t *) &Ahead_Entry + Ahead_Done : &Next_Page_Buffer [Ahead_Done - Ahead_Entry_Size];
+		uint16_t _Count = min (_Limit, (Ahead_Done < Ahead_Entry_Size ? Ahead_Entry_Size : _Total) - Ahead_Done);
+
+		// Read Chunk
+		if (Ahead_File->read (_Into, _Count) != (int) _Count) Ahead_Failed = true;
+
+		Ahead_Done += _Count;
+		_Limit -= _Count;
+
+	}
+
+	// End Function
+	return (Ahead_Done >= _Total || Ahead_Failed);
+
+}
+
+// Read Ahead Chunk (Busy_Work while reading ahead)
+bool Read_Ahead_Chunk (void) {
+
+	// End Function
+	return (Read_Ahead (Read_Ahead_Chunk_Size));
+
+}
+
+// Start Read Ahead (_Pages pages, each after a map entry of _Entry_Size bytes)
+void Start_Read_Ahead (SdFile & _File, const uint16_t _Pages, const uint8_t _Entry_Size) {
+
+	Ahead_File = &_File;
+	Ahead_Pages_Left = _Pages;
+	Ahead_Entry_Size = _Entry_Size;
+	Ahead_Done = 0;
+	Ahead_Failed = false;
+
+}
+
+// Stop Read Ahead (before the file is closed)
+void Stop_Read_Ahead (void) {
+
+	Busy_Work = NULL;
+	Ahead_File = NULL;
+
+}
+
+// Next Page (finish reading the next page, leave its map entry in _Entry and the page in Page_Buffer, and start on the one after)
+bool Next_Page (void * _Entry) {
+
+	// Nothing to Do Between Polls Until Started Again
+	Busy_Work = NULL;
+
+	// Control for End of File
+	if (Ahead_Pages_Left == 0) return true;
+
+	// Read What Is Left
+	Read_Ahead (Ahead_Entry_Size + pagesize);
+	if (Ahead_Failed) return true;
+
+	// Hand Over Page
+	memcpy (_Entry, &Ahead_Entry, Ahead_Entry_Size);
+	uint8_t * _Page = Page_Buffer;
+	Page_Buffer = Next_Page_Buffer;
+	Next_Page_Buffer = _Page;
+
+	// Start on the Next
+	Ahead_Done = 0;
+	if (--Ahead_Pages_Left > 0 && READ_AHEAD) Busy_Work = Read_Ahead_Chunk; // else the next read would land in the page being written
+
+	// End Function
+	return false;
+
+}
+
+// Read Image
+bool Read_Image (const uint8_t _Action) {
+
+	// Declare Variables
+	SdFile _Image;
+	Image_Header_Type _Header;
+	Image_Page_Type _Page;
+
+	// Open Image and Check Header
+	if (!_Image.open (Image_Name, O_READ) || _Image.read (&_Header, sizeof _Header) != (int) sizeof _Header || _Header.Magic != IMAGE_MAGIC || _Header.Page_Size != pagesize) {
+
+		// Close Image
+		_Image.close ();
+
+		// Show Message
+		Show_Message (MSG_CANNOT_OPEN_FILE);
+
+		// End Function
+		return true;
+
+	}
+
+	// no lines get processed, so take these from the check pass
+	lowestAddress = _Header.Lowest_Address;
+	highestAddress = _Header.Highest_Address;
+	bytesWritten = _Header.Bytes_Written;
+
+	// pages a session cut short already wrote, see Resume_Pages
+	const uint16_t _First = _Action == Action_Write_To_Flash ? Stats.Pages_Resumed : 0;
+	if (_First > 0 && !_Image.seekSet (sizeof _Header + _First * (sizeof _Page + pagesize))) {
+
+		// Close Image
+		_Image.close ();
+
+		// Show Message
+		Show_Message (MSG_CANNOT_OPEN_FILE);
+
+		// End Function
+		return true;
+
+	}
+
+	// Control for Compare (write it instead)
+	if (_Action == Action_Compare_Flash && !Worth_Comparing (_Header.Page_Count)) {
+
+		// Close Image
+		_Image.close ();
+
+		// Count Difference
+		errors++;
+
+		// End Function
+		return false;
+
+	}
+
+	// Stream Pages
+	Start_Read_Ahead (_Image, _Header.Page_Count - _First, sizeof _Page);
+	for (uint16_t i = _First; i < _Header.Page_Count; i++) {
+
+		// page map entry, then the page itself
+		if (Next_Page (&_Page) || Page_CRC () != _Page.CRC) {
+
+			// Close Image
+			Stop_Read_Ahead ();
+			_Image.close ();
+
+			// Show Message
+			Show_Message (MSG_BAD_SUMCHECK);
+
+			// End Function
+			return true;
+
+		}
+
+		// Action
+		switch (_Action) {
+
+			case Action_Verify_Flash:
+				memset (Covered_Mask, 0xFF, sizeof Covered_Mask);  // whole page
+				Verify_Page (_Page.Address);
+				break;
+
+			case Action_Write_To_Flash:
+				memset (Covered_Mask, 0xFF, sizeof Covered_Mask);  // whole page
+				Write_Page (_Page.Address);
+				Journal_Progress (i + 1);
+				break;
+
+			case Action_Compare_Flash:
+				Compare_Blank (_Page.Address);
+				Compare_Page (_Page.Address);
+				Compared_To = _Page.Address + pagesize;
+				break;
+
+		}
+
+		// no need to read the rest
+		if ((_Action == Action_Compare_Flash && errors > 0) || Stats.Timeouts > 0) break;
+
+	}
+
+	// Close Image
+	Stop_Read_Ahead ();
+	_Image.close ();
+
+	// End Function
+	return false;
+
+}
+
+// Find PFW (true if there is a .pfw file on the card, leaves its header in PFW_Header)
+bool Find_PFW (void) {
+
+	// Declare File
+	SdFile _PFW;
+
+	// Open File and Check Magic
+	bool _Found = _PFW.open (PFW_Name, O_READ) && _PFW.read (&PFW_Header, sizeof PFW_Header) == (int) sizeof PFW_Header && (PFW_Header.Magic == PFW_MAGIC || PFW_Header.Magic == PFWZ_MAGIC);
+
+	// Close File
+	_PFW.close ();
+
+	// End Function
+	return _Found;
+
+}
+
+// Define Compressed Page Variables (see Unpack_Page)
+uint8_t PFW_Chunk [PFW_Chunk_Size];
+uint8_t PFW_Chunk_Count, PFW_Chunk_Used;
+unsigned long PFW_Packed_Left;  // compressed bytes of the page not read yet
+uint32_t * PFW_CRC;             // CRC to add what is read to, or NULL
+
+// Next Packed Byte (next byte of the compressed page, or -1 if there are no more)
+int Next_Packed_Byte (SdFile & _PFW) {
+
+	// Chunk Used Up
+	if (PFW_Chunk_Used >= PFW_Chunk_Count) {
+
+		// Control for End of Page
+		if (PFW_Packed_Left == 0) return -1;
+
+		// Read Chunk
+		int _Count = _PFW.read (PFW_Chunk, min (PFW_Packed_Left, (unsigned long) sizeof PFW_Chunk));
+
+		// Control for Read Error
+		if (_Count <= 0) return -1;
+
+		// Add to CRC
+		if (PFW_CRC) * PFW_CRC = CRC32_Update (* PFW_CRC, PFW_Chunk, _Count);
+
+		// Set Variables
+		PFW_Packed_Left -= _Count;
+		PFW_Chunk_Count = _Count;
+		PFW_Chunk_Used = 0;
+
+	}
+
+	// End Function
+	return PFW_Chunk [PFW_Chunk_Used++];
+
+}
+
+// Unpack Page (decompress the next _Length bytes of the .pfw file into Page_Buffer)
+//  0nnnnnnn = n + 1 literal bytes follow, 1nnnnnnn oooooooo = copy n + 3 bytes from o + 1 bytes back in the page
+bool Unpack_Page (SdFile & _PFW, const unsigned long _Length, uint32_t * _CRC) {
+
+	// Set Variables
+	PFW_Chunk_Count = PFW_Chunk_Used = 0;
+	PFW_Packed_Left = _Length;
+	PFW_CRC = _CRC;
+
+	// Declare Variables
+	uint16_t _Out = 0;
+	int _Token;
+
+	// Decode Each Token
+	while ((_Token = Next_Packed_Byte (_PFW)) >= 0) {
+
+		// Copy From Earlier in the Page
+		if (_Token & 0x80) {
+
+			// Declare Variables
+			uint16_t _Count = (_Token & 0x7F) + 3;
+			int _Back = Next_Packed_Byte (_PFW);
+
+			// Control for Bounds
+			if (_Back < 0 || (uint16_t) _Back >= _Out || _Out + _Count > pagesize) return true;
+
+			// byte by byte, the copy may overlap what it is making
+			const uint8_t * _From = &Page_Buffer [_Out - _Back - 1];
+			while (_Count--) Page_Buffer [_Out++] = * _From++;
+
+		// Literal Bytes
+		} else {
+
+			// Declare Count
+			uint16_t _Count = _Token + 1;
+
+			// Control for Bounds
+			if (_Out + _Count > pagesize) return true;
+
+			// Copy Literals
+			while (_Count--) {
+
+				// Read Byte
+				int _Byte = Next_Packed_Byte (_PFW);
+
+				// Control for End
+				if (_Byte < 0) return true;
+
+				// Set Byte
+				Page_Buffer [_Out++] = _Byte;
+
+			}
+
+		}
+
+	}
+
+	// short page, or a read error part way through
+	return _Out != pagesize || PFW_Packed_Left != 0;
+
+}
+
+// Read PFW Page (next page map entry and page into _Page and Page_Buffer, adding what was read to *_CRC if it isn't NULL)
+bool Read_PFW_Page (SdFile & _PFW, const bool _Packed, PFW_Page_Type & _Page, uint32_t * _CRC) {
+
+	// Compressed Page
+	if (_Packed) {
+
+		// Declare Entry
+		PFW_Packed_Page_Type _Packed_Page;
+
+		// Read Entry
+		if (_PFW.read (&_Packed_Page, sizeof _Packed_Page) != (int) sizeof _Packed_Page) return true;
+
+		// Add to CRC
+		if (_CRC) * _CRC = CRC32_Update (* _CRC, &_Packed_Page, sizeof _Packed_Page);
+
+		// Set Page
+		_Page.Address = _Packed_Page.Address;
+		_Page.CRC = _Packed_Page.CRC;
+
+		// Unpack Page
+		return Unpack_Page (_PFW, _Packed_Page.Length, _CRC);
+
+	}
+
+	// Read Entry and Page
+	if (_PFW.read (&_Page, sizeof _Page) != (int) sizeof _Page || _PFW.read (Page_Buffer, pagesize) != (int) pagesize) return true;
+
+	// Add to CRC
+	if (_CRC) {
+
+		* _CRC = CRC32_Update (* _CRC, &_Page, sizeof _Page);
+		* _CRC = CRC32_Update (* _CRC, Page_Buffer, pagesize);
+
+	}
+
+	// End Function
+	return false;
+
+}
+
+// Read PFW (stream the .pfw file, checking each page CRC and in the check pass the CRC of the whole file)
+bool Read_PFW (const uint8_t _Action) {
+
+	// Declare Variables
+	SdFile _PFW;
+	PFW_Header_Type _Header;
+	PFW_Page_Type _Page;
+	uint32_t _Image_CRC = 0xFFFFFFFF;
+
+	// Open File and Check Header
+	if (!_PFW.open (PFW_Name, O_READ) || _PFW.read (&_Header, sizeof _Header) != (int) sizeof _Header || (_Header.Magic != PFW_MAGIC && _Header.Magic != PFWZ_MAGIC)) {
+
+		// Close File
+		_PFW.close ();
+
+		// Show Message
+		Show_Message (MSG_CANNOT_OPEN_FILE);
+
+		// End Function
+		return true;
+
+	}
+
+	// made for another chip?
+	if (memcmp (_Header.Signature, Current_Signature.Signature, sizeof _Header.Signature) != 0 || _Header.Page_Size != pagesize || _Header.Flash_Size != Current_Signature.Flash_Size) {
+
+		// Close File
+		_PFW.close ();
+
+		// Show Message
+		Show_Message (MSG_UNRECOGNIZED_SIGNATURE);
+
+		// End Function
+		return true;
+
+	}
+
+	// no lines get processed, so take these from the header
+	lowestAddress = _Header.Lowest_Address;
+	highestAddress = _Header.Highest_Address;
+	bytesWritten = _Header.Bytes_Written;
+
+	// Control for Compare (write it instead)
+	if (_Action == Action_Compare_Flash && !Worth_Comparing (_Header.Page_Count)) {
+
+		// Close File
+		_PFW.close ();
+
+		// Count Difference
+		errors++;
+
+		// End Function
+		return false;
+
+	}
+
+	// uncompressed pages are read ahead while writing, the rest in turn
+	const bool _Ahead = _Action == Action_Write_To_Flash && _Header.Magic == PFW_MAGIC;
+	if (_Ahead) Start_Read_Ahead (_PFW, _Header.Page_Count, sizeof _Page);
+
+	// Stream Pages
+	for (uint16_t i = 0; i < _Header.Page_Count; i++) {
+
+		// page map entry, then the page itself
+		if ((_Ahead ? Next_Page (&_Page) : Read_PFW_Page (_PFW, _Header.Magic == PFWZ_MAGIC, _Page, _Action == Action_Check_File ? &_Image_CRC : NULL)) || (uint32_t) ~CRC32_Update (0xFFFFFFFF, Page_Buffer, pagesize) != _Page.CRC) {
+
+			// Close File
+			Stop_Read_Ahead ();
+			_PFW.close ();
+
+			// Show Message
+			Show_Message (MSG_BAD_SUMCHECK);
+
+			// End Function
+			return true;
+
+		}
+
+		// Action
+		switch (_Action) {
 
-	}
-	
-	// two bytes of address
-	uint8_t _Address_High = _HEX_Buffer [1];
-	uint8_t _Address_Low = _HEX_Buffer [2];
-	uint16_t _Address = _Address_Low | (_Address_High << 8);
+			case Action_Check_File:
+				if (i % 8 == 0) LED_Show_Progress ();
+				break;
 
-	// Record Type
-	uint8_t _Record_Type = _HEX_Buffer [3];
+			case Action_Verify_Flash:
+				memset (Covered_Mask, 0xFF, sizeof Covered_Mask);  // whole page
+				Verify_Page (_Page.Address);
+				break;
 
-	// Switch Record Type
-	switch (_Record_Type) {
-	
-		// Data Record
-		case HEX_Data_Record: {
+			case Action_Write_To_Flash:
+				memset (Covered_Mask, 0xFF, sizeof Covered_Mask);  // whole page
+				Write_Page (_Page.Address);
+				break;
 
-			lowestAddress  = min (lowestAddress, _Address + extendedAddress);
-			highestAddress = max (lowestAddress, _Address + extendedAddress + _Len - 1);
-			bytesWritten += _Len;
-	
-			switch (action) {
-				case Action_Check_File:  // nothing much to do, we do the checks anyway
-					break;
-		  
-				case Action_Verify_Flash:
-					Verify_Data (_Address + extendedAddress, &_HEX_Buffer [4], _Len);
-					break;
-		
-				case Action_Write_To_Flash:
-					Write_Data (_Address + extendedAddress, &_HEX_Buffer [4], _Len);
-					break;
-					
-			} // end of switch on action
-			break;
+			case Action_Compare_Flash:
+				Compare_Blank (_Page.Address);
+				Compare_Page (_Page.Address);
+				Compared_To = _Page.Address + pagesize;
+				break;
 
 		}
-  
-		// end of data
-		case HEX_End_Of_File: {
 
-			// Set End Of File
-			gotEndOfFile = true;
-			
-			// End Function
-			break;
+		// no need to read the rest
+		if ((_Action == Action_Compare_Flash && errors > 0) || Stats.Timeouts > 0) break;
 
-		}
-  
-		// we are setting the high-order byte of the address
-		case HEX_Extended_Segment_Address_Record: {
+	}
 
-			extendedAddress = ((unsigned long) _HEX_Buffer [4]) << 12;
-			break;
+	// Close File
+	Stop_Read_Ahead ();
+	_PFW.close ();
 
-		}
+	// Control for File CRC
+	if (_Action == Action_Check_File && (uint32_t) ~_Image_CRC != _Header.Image_CRC) {
 
-		// Default		
-		default: {
-			
-			// Show Message
-			Show_Message (MSG_UNKNOWN_RECORD_TYPE);
-			
-			// End Function
-			return true;
+		// Show Message
+		Show_Message (MSG_BAD_SUMCHECK);
 
-		}
+		// End Function
+		return true;
 
 	}
 
@@ -676,15 +2568,6 @@ bool Process_Line (const char * pLine, const byte action) {
 // Read Hex File
 bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 
-	// Declare Buffer
-	char _Buffer[80];
-
-	// Clear Buffer
-	memset (_Buffer, '\0', 80);
-
-	// Declare File
-	ifstream sdin (_File_Name);
-
 	// Clear Variables
 	gotEndOfFile = false;
 	extendedAddress = 0;
@@ -695,27 +2578,7 @@ bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 	progressBarCount = 0;
 	pagesize = Current_Signature.Page_Size;
 	pagemask = ~(pagesize - 1);
-	oldPage = 0xFFFFFFFF;
-	
-	// check for open error
-	if (!sdin.is_open()) {
-
-		// Show Message
-		Show_Message(MSG_CANNOT_OPEN_FILE);
-
-		// Set Burn Enable Pin LOW
-		Burn_Enable_PORT &= ~(1 << Burn_Enable_PIN);
-
-		// Set Power Done Pin HIGH
-		Power_Done_PORT |= (1 << Power_Done_PIN);
-		
-		// Sleep Delay
-		delay(500);
-
-		// End Function
-		return true;
-
-	}
+	Buffered_Page = NO_PAGE;
 
 	// Action
 	switch (_Action) {
@@ -736,71 +2599,87 @@ bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 
 		}
 
-		// Write To Flash	
-		case Action_Write_To_Flash: {
+		// Compare Flash
+		case Action_Compare_Flash: {
 
-			// Program Enable
-			Program (Command_Progam_Enable, Command_Chip_Erase);
-			
-			// Command Delay
-			delay (20);
+			// the flash between the image's pages is checked as they go by, which needs them in address order: the page image and the .pfw file have them so, a .hex file need not
+			Compared_To = 0;
+			if (!PFW_Ready && !Image_Ready) {
 
-			// Poll Until Ready
-			Poll_Until_Ready ();
+				// Count Difference (can't tell, write it)
+				errors++;
+
+				// End Function
+				return false;
+
+			}
 
-			// Clear Page
-			Clear_Page();
-		
 			// Break
 			break;
 
 		}
-			
-	}
 
-	// Read Hex File
-	while (sdin.getline (_Buffer, 80)) {
+		// Write To Flash	
+		case Action_Write_To_Flash: {
 
-		// check for line too long
-		int count = sdin.gcount();
+			// carry on after a session cut short (single target, page image only), or start from the erase
+			Journal_On = Image_Ready && !PFW_Ready;
+			Stats.Pages_Resumed = Resume_Pages ();
 
-		// check for line too long
-		if (sdin.fail()) {
+			// Erase
+			if (Stats.Pages_Resumed == 0) {
 
-			// Show Message
-			Show_Message (MSG_LINE_TOO_LONG);
-			
-			// End Function
-			return true;
+				// Program Enable
+				Program (Command_Progam_Enable, Command_Chip_Erase);
 
-		}
-	  
-		// ignore empty lines
-		if (count > 1) {
+				// Poll Until Ready
+				if (!Poll_Until_Ready (Busy_Erase)) {
 
-			// Process Line
-			if (Process_Line (_Buffer, _Action)) return true;
+					// Show Message
+					Show_Message (MSG_TARGET_NOT_READY);
 
-		}
+					// End Function
+					return true;
 
-	}
+				}
 
-	// Close File
-	if (!gotEndOfFile) {
+				// Start Journal
+				if (Journal_On) Start_Journal ();
 
-		// Show Message
-		Show_Message (MSG_NO_END_OF_FILE_RECORD);
+			}
 
-		// Set Burn Enable Pin LOW
-		Burn_Enable_PORT &= ~(1 << Burn_Enable_PIN);
+			// Clear Page (Load_Page keeps track from here)
+			Clear_Page();
+			memset (Loaded_Mask, 0, sizeof Loaded_Mask);
 
-		// Set Power Done Pin HIGH
-		Power_Done_PORT |= (1 << Power_Done_PIN);
+			// the card is read next, and its select is Digital SPI SCK: let the queued loads go out first
+			Flush_ISP_Queue ();
 		
-		// Sleep Delay
-		delay(200);
+			// Break
+			break;
 
-		// End Function		
+		}
+			
+	}
+
+	// a .pfw file takes the place of the .hex file
+	if (PFW_Ready) {
+
+		// Stream Container
+		if (Read_PFW (_Action)) return true;
+
+	// the check pass left a page image behind? then it is the only pass that has to parse the .hex file
+	} else if (_Action != Action_Check_File && Image_Ready) {
+
+		// Stream Image
+		if (Read_Image (_Action)) return true;
+
+	} else if (Parse_Hex_File (_File_Name, _Action)) {
+
+		// Drop Image
+		if (_Action == Action_Check_File) Drop_Image ();
+
+		// End Function
 		return true;
 
 	}
@@ -812,7 +2691,41 @@ bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 		case Action_Write_To_Flash: {
 
 			// Commit Page
-			if (oldPage != 0xFFFFFFFF) Commit_Page (oldPage);
+			if (Buffered_Page != NO_PAGE) Write_Page (Buffered_Page);
+
+			// Error (the target stayed busy after a page write)
+			if (Stats.Timeouts > 0) {
+
+				// Show Message
+				Show_Message (MSG_TARGET_NOT_READY);
+
+				// End Function
+				return true;
+
+			}
+
+			// Error (a page did not read back correctly)
+			if (errors > 0) {
+
+				// Show Message
+				Show_Message (MSG_VERIFICATION_ERROR);
+
+				// Set Burn Enable Pin LOW
+				Burn_Enable_PORT &= ~(1 << Burn_Enable_PIN);
+
+				// Set Power Done Pin HIGH
+				Power_Done_PORT |= (1 << Power_Done_PIN);
+
+				// Sleep Delay
+				delay(200);
+
+				// End Function
+				return true;
+
+			}
+
+			// the whole image is on the target, nothing to resume
+			if (Journal_On) Add_Journal_Record (Journal_Done);
 
 			// Break
 			break;
@@ -822,6 +2735,9 @@ bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 		// Verify Flash
 		case Action_Verify_Flash: {
 
+			// Verify Final Page
+			if (Buffered_Page != NO_PAGE) Verify_Page (Buffered_Page);
+
 			// Error
 			if (errors > 0) {
 
@@ -847,9 +2763,23 @@ bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 
 		}
 
+		// Compare Flash
+		case Action_Compare_Flash: {
+
+			// and on up to the end of the flash (errors tells the caller whether the target differs)
+			Compare_Blank (Current_Signature.Flash_Size);
+
+			// Break
+			break;
+
+		}
+
 		// Check File
 		case Action_Check_File: {
 
+			// Finish Page Image
+			if (!PFW_Ready) Finish_Image ();
+
 			// Break
 			break;
 
@@ -862,9 +2792,128 @@ bool Read_Hex_File(const char * _File_Name, const uint8_t _Action) {
 
 }
 
+// Define Validation Cache Variables (this session's input file, and whether the check pass found it out, to be kept)
+Validation_Type Validation;
+bool Validation_New;
+
+// Validation Address
+int Validation_At (void) {
+
+	// End Function
+	return (Journal_Headers * sizeof (Journal_Header_Type) + Journal_Slots * sizeof (Journal_Record_Type));
+
+}
+
+// Validation Key (size and modified time of the input file, and its first block if _Read_First, the card read is left until it is needed)
+bool Validation_Key (Validation_Key_Type & _Key, const bool _Read_First) {
+
+	// Declare Variables
+	SdFile _File;
+	uint8_t _Chunk [32];
+	memset (&_Key, 0, sizeof _Key);
+
+	// Open File
+	if (!_File.open (PFW_Ready ? PFW_Name : Firmware_Name, O_READ) || !_File.getModifyDateTime (&_Key.Date, &_Key.Time)) return (false);
+	_Key.Size = _File.fileSize ();
+
+	// First Block CRC
+	_Key.First_CRC = 0xFFFFFFFF;
+	for (uint16_t _Done = 0; _Read_First && _Done < Validation_Block_Size; _Done += sizeof _Chunk) {
+
+		// Read Chunk
+		const int _Count = _File.read (_Chunk, sizeof _Chunk);
+
+		// short file
+		if (_Count <= 0) break;
+
+		// Add to CRC
+		_Key.First_CRC = CRC32_Update (_Key.First_CRC, _Chunk, _Count);
+
+	}
+
+	// Close File
+	_File.close ();
+
+	// Chip and Kind of File
+	memcpy (_Key.Signature, Current_Signature.Signature, sizeof _Key.Signature);
+	_Key.PFW = PFW_Ready;
+
+	// End Function
+	return (true);
+
+}
+
+// Validated Before (true if the file was checked before and nothing it depends on changed, then takes the check pass's findings from EEPROM)
+bool Validated_Before (void) {
+
+	// Read Cache
+	Validation_Type _Kept;
+	EEPROM.get (Validation_At (), _Kept);
+
+	// the first block is only read if the rest of the key matches
+	Validation.Key.First_CRC = _Kept.Key.First_CRC;
+	if (_Kept.Magic != Validation_Magic || memcmp (&_Kept.Key, &Validation.Key, sizeof _Kept.Key) != 0 || !Validation_Key (Validation.Key, true) || Validation.Key.First_CRC != _Kept.Key.First_CRC) return (false);
+
+	// the page image has to be the one that check pass left
+	if (_Kept.Image_Ready) {
+
+		// Read Image Header
+		SdFile _Image;
+		Image_Header_Type _Header;
+		const bool _Same = _Image.open (Image_Name, O_READ) && _Image.read (&_Header, sizeof _Header) == (int) sizeof _Header && _Header.Magic == IMAGE_MAGIC && _Header.Page_Size == Current_Signature.Page_Size && _Header.Lowest_Address == _Kept.Lowest_Address && _Header.Highest_Address == _Kept.Highest_Address && _Header.Bytes_Written == _Kept.Bytes_Written;
+		_Image.close ();
+
+		// Control for Image
+		if (!_Same) return (false);
+
+	}
+
+	// Take Findings
+	lowestAddress = _Kept.Lowest_Address;
+	highestAddress = _Kept.Highest_Address;
+	bytesWritten = _Kept.Bytes_Written;
+	Boot_Size = _Kept.Boot_Size;
+	Image_Ready = _Kept.Image_Ready;
+	Image_Map_CRC = _Kept.Image_Map_CRC;
+
+	// End Function
+	return (true);
+
+}
+
+// Save Validation (keep what the check pass found between sessions, each byte takes 3.4 mS)
+// only if the file is still on the card, a target that flashed OK takes it away; and still the one that was checked
+void Save_Validation (void) {
+
+	// Control for Findings
+	if (!Validation_New) return;
+	Validation_New = false;
+
+	// Control for File
+	Validation_Key_Type _Key;
+	if (!Validation_Key (_Key, true) || _Key.Size != Validation.Key.Size || _Key.Date != Validation.Key.Date || _Key.Time != Validation.Key.Time) return;
+	Validation.Key = _Key;
+
+	// not valid until the last byte is written
+	Validation.Magic = 0;
+	EEPROM.put (Validation_At (), Validation);
+	EEPROM.update (Validation_At () + offsetof (Validation_Type, Magic), Validation_Magic);
+
+}
+
 // Choose Input File
 bool Choose_Input_File(void) {
  
+	// a .pfw file takes the place of the .hex file
+	PFW_Ready = Find_PFW ();
+
+	// checked in an earlier session? nothing to parse then
+	const bool _Keyed = Validation_Key (Validation.Key, false);
+	if (_Keyed && Validated_Before ()) {
+		Stats.Check_Skipped = true;
+		return false;
+	}
+
 	// Check File
 	if (Read_Hex_File(Firmware_Name, Action_Check_File)) return true;
   
@@ -875,7 +2924,17 @@ bool Choose_Input_File(void) {
 	}
   
 	// check start address makes sense
+	Boot_Size = Decide_Boot_Size ();
 	if (Update_Fuses (false)) return true;
+
+	// for the next session, see Save_Validation
+	Validation.Lowest_Address = lowestAddress;
+	Validation.Highest_Address = highestAddress;
+	Validation.Bytes_Written = bytesWritten;
+	Validation.Boot_Size = Boot_Size;
+	Validation.Image_Ready = Image_Ready;
+	Validation.Image_Map_CRC = Image_Map_CRC;
+	Validation_New = _Keyed;
 	
 	// End Function
 	return false;
@@ -886,23 +2945,80 @@ bool Choose_Input_File(void) {
 bool Write_Flash_Contents(void) {
 	
   errors = 0;
+  memset (&Stats, 0, sizeof Stats);
   
   if (Choose_Input_File()) return false;
 
   // ensure back in programming mode
   if (!Digital_SPI_Start_Programming ()) return false;
 
+	// target already holds this image? then leave the flash alone
+	if (Compare_Before_Write) {
+
+		// Compare Flash
+		if (Read_Hex_File(Firmware_Name, Action_Compare_Flash)) return false;
+
+		// Control for Match
+		if (errors == 0) {
+
+			// Set Unchanged
+			Stats.Unchanged = true;
+
+			// Update Fuses
+			Update_Fuses (true);
+			Write_PFW_Fuses ();
+
+			// Error (the target stayed busy after a fuse write)
+			if (Stats.Timeouts > 0) {
+
+				// Show Message
+				Show_Message (MSG_TARGET_NOT_READY);
+
+				// End Function
+				return false;
+
+			}
+
+			// End Function
+			return true;
+
+		}
+
+	}
+
   // now commit to flash
   if (Read_Hex_File(Firmware_Name, Action_Write_To_Flash)) return false;
 
-	// Set Working LED ON
-	LED_Green_PORT |= (1 << LED_Green_PIN);
+	// each page was read back as it was written
+	if (!Verify_On_Write) {
+
+		// Set Working LED ON
+		LED_Green_PORT |= (1 << LED_Green_PIN);
 
-  // verify
-  if (Read_Hex_File(Firmware_Name, Action_Verify_Flash)) return false;
+		// verify
+		if (Read_Hex_File(Firmware_Name, Action_Verify_Flash)) return false;
+
+	}
 
   // now fix up fuses so we can boot
-  if (errors == 0) Update_Fuses (true);
+  if (errors == 0) {
+
+		// Update Fuses
+		Update_Fuses (true);
+		Write_PFW_Fuses ();
+
+	}
+
+	// Error (the target stayed busy after a fuse write)
+	if (Stats.Timeouts > 0) {
+
+		// Show Message
+		Show_Message (MSG_TARGET_NOT_READY);
+
+		// End Function
+		return false;
+
+	}
 	
   return errors == 0;
 	
@@ -911,17 +3027,43 @@ bool Write_Flash_Contents(void) {
 // Stop Programming
 void Digital_SPI_Stop_Programming (void) {
 
-	// Turn Digital SPI Pins Pull-Up OFF
-	Digital_MISO_PORT &= ~(1 << Digital_MISO_PIN);
-	Digital_MOSI_PORT &= ~(1 << Digital_MOSI_PIN);
-	Digital_SCK_PORT &= ~(1 << Digital_SCK_PIN);
-	Digital_Reset_PORT &= ~(1 << Digital_Reset_PIN);
+	// Set Digital RESET LOW and INPUT
+	Digital_SPI::Release_Reset ();
+
+	// Release Transport Pins
+	Stop_Transport ();
+
+	// next target may be different
+	ISP_Speed_Locked = false;
+	foundSig = -1;
+
+}
+
+// Log Busy (append " label=shortest/average/longest" busy times, uS)
+void Log_Busy (ofstream & sdout, const __FlashStringHelper * _Label, const Busy_Stats_Type & _Stats) {
+
+	// no writes of this kind
+	if (_Stats.Count == 0) return;
+
+	// Write Times
+	sdout << _Label << _Stats.Shortest << '/' << _Stats.Total / _Stats.Count << '/' << _Stats.Longest;
+
+}
 
-	// Set Digital SPI Pins as INPUT
-	Digital_MISO_DDR &= ~(1 << Digital_MISO_PIN);
-	Digital_MOSI_DDR &= ~(1 << Digital_MOSI_PIN);
-	Digital_SCK_DDR &= ~(1 << Digital_SCK_PIN);
-	Digital_Reset_DDR &= ~(1 << Digital_Reset_PIN);
+// Log Session (append a summary of this session to Log_Name)
+void Log_Session (const bool _OK) {
+
+	// Open Log File
+	ofstream sdout (Log_Name, ios::out | ios::app);
+
+	// Write Summary
+	sdout << (_OK ? F("OK") : F("FAILED")) << (Stats.Unchanged ? F(" unchanged") : F("")) << (Stats.Check_Skipped ? F(" checkSkipped") : F("")) << F(" pagesWritten=") << Stats.Pages_Written << F(" pagesSkipped=") << Stats.Pages_Skipped << F(" pagesMatched=") << Stats.Pages_Matched << F(" pagesResumed=") << Stats.Pages_Resumed << F(" pagesRetried=") << Stats.Pages_Retried << F(" pagesFailed=") << Stats.Pages_Failed << F(" timeouts=") << Stats.Timeouts;
+
+	// Write Busy Times
+	Log_Busy (sdout, F(" flashUs="), Stats.Busy[Busy_Flash]);
+	Log_Busy (sdout, F(" eraseUs="), Stats.Busy[Busy_Erase]);
+	Log_Busy (sdout, F(" fuseUs="), Stats.Busy[Busy_Fuse]);
+	sdout << '\n';
 
 }
 
@@ -934,6 +3076,9 @@ void setup (void) {
 	DDRC	|= 0b00001110;
 	PORTC	&= 0b11110001;
 
+	// status messages play in the background from here on
+	Start_LED_Timer ();
+
 	// Port B
 	DDRB	|= 0b00000011;
 	PORTB 	&= 0b11111100;
@@ -1006,11 +3151,8 @@ void loop (void) {
 	// Get Fuse Byte
 	Get_Fuse_Bytes();
   
-	// No Signature Found
+	// No Signature Found (Get_Signature has said why)
 	if (foundSig == -1) {
-		
-		// Signature Error Message
-		Show_Message (MSG_CANNOT_FIND_SIGNATURE);
 
 		// Set Burn Enable Pin LOW
 		Burn_Enable_PORT &= ~(1 << Burn_Enable_PIN);
@@ -1035,9 +3177,9 @@ void loop (void) {
 	// Set Working LED OFF
 	LED_Blue_PORT &= ~(1 << LED_Blue_PIN);
 
-	// Delay
-	delay (200);
-  
+	// Log Session
+	Log_Session (_OK);
+
 	// OK Message
 	if (_OK) Show_Message (MSG_FLASHED_OK);
 
@@ -1055,7 +3197,10 @@ void loop (void) {
 	// Set Power Done Pin HIGH
 	Power_Done_PORT |= (1 << Power_Done_PIN);
 
-	// Sleep Delay
-	delay(200);
+	// Sleep Delay (less the time the last EEPROM writes took)
+	const unsigned long _Sleep_Start = millis ();
+	Flush_Journal ();
+	Save_Validation ();
+	delay (200 - min (millis () - _Sleep_Start, 200UL));
 
 }
@@ -0,0 +1,178 @@
+// Bit Banged ISP Core (specialised at compile time on a board's pin map)
+//
+// A board profile names the port and bit of each ISP signal as types, e.g.
+//
+//	struct Board {
+//		typedef ISP_Pin <ISP_Port_D, 2>	SCK_Pin;
+//		typedef ISP_Pin <ISP_Port_D, 1>	MOSI_Pin;
+//		typedef ISP_Pin <ISP_Port_D, 0>	MISO_Pin;
+//		typedef ISP_Pin <ISP_Port_D, 3>	Reset_Pin;
+//		static constexpr uint8_t		Bit_Delay = 6;
+//	};
+//
+// and ISP_Core <Board> is the transfer / reset code for that wiring. Every
+// register address and bit mask is a constant once the small functions below
+// are inlined, so each pin access is a single sbi / cbi / sbis instead of a
+// digitalWrite or pinMode table lookup.
+
+#ifndef ISP_Core_h
+#define ISP_Core_h
+
+// Define Ports (output, direction and input register of each)
+struct ISP_Port_B {
+
+	static inline volatile uint8_t & Out (void) { return (PORTB); }
+	static inline volatile uint8_t & Dir (void) { return (DDRB); }
+	static inline volatile uint8_t & In (void) { return (PINB); }
+
+};
+
+struct ISP_Port_C {
+
+	static inline volatile uint8_t & Out (void) { return (PORTC); }
+	static inline volatile uint8_t & Dir (void) { return (DDRC); }
+	static inline volatile uint8_t & In (void) { return (PINC); }
+
+};
+
+struct ISP_Port_D {
+
+	static inline volatile uint8_t & Out (void) { return (PORTD); }
+	static inline volatile uint8_t & Dir (void) { return (DDRD); }
+	static inline volatile uint8_t & In (void) { return (PIND); }
+
+};
+
+// Define Pin (one bit of a port)
+template <class Port, uint8_t Bit> struct ISP_Pin {
+
+	static constexpr uint8_t Mask = 1 << Bit;
+
+	static inline void High (void) { Port::Out () |= Mask; }
+	static inline void Low (void) { Port::Out () &= ~Mask; }
+	static inline void Output (void) { Port::Dir () |= Mask; }
+	static inline void Input (void) { Port::Dir () &= ~Mask; }
+	static inline bool Read (void) { return ((Port::In () & Mask) != 0); }
+
+};
+
+// Define ISP Core
+template <class Board> struct ISP_Core {
+
+	typedef typename Board::SCK_Pin		SCK;
+	typedef typename Board::MOSI_Pin	MOSI;
+	typedef typename Board::MISO_Pin	MISO;
+	typedef typename Board::Reset_Pin	Reset;
+
+	// Transfer (SPI mode 0, MSB first, _Delay uS between clock edges)
+	static inline uint8_t Transfer (uint8_t c, const uint8_t _Delay) {
+
+		for (uint8_t _Bit = 0; _Bit < 8; _Bit++) {
+
+			// write MOSI on falling edge of previous clock
+			if (c & 0x80) MOSI::High (); else MOSI::Low ();
+			c <<= 1;
+
+			// read MISO
+			c |= MISO::Read ();
+
+			// clock high
+			SCK::High ();
+
+			// delay between rise and fall of clock
+			delayMicroseconds (_Delay);
+
+			// clock low
+			SCK::Low ();
+
+			// delay between rise and fall of clock
+			delayMicroseconds (_Delay);
+
+		}
+
+		// End Function
+		return (c);
+
+	}
+
+	// Gang Transfer (as Transfer, to several targets on the shared SCK and MOSI, target n answering on bit n of MISO_Port, _In [n] gets its byte)
+	template <class MISO_Port> static inline void Gang_Transfer (uint8_t c, uint8_t * _In, const uint8_t _Targets, const uint8_t _Delay) {
+
+		for (uint8_t _Bit = 0; _Bit < 8; _Bit++) {
+
+			// write MOSI on falling edge of previous clock
+			if (c & 0x80) MOSI::High (); else MOSI::Low ();
+			c <<= 1;
+
+			// read every MISO at once
+			uint8_t _Pins = MISO_Port::In ();
+
+			// clock high
+			SCK::High ();
+
+			// shift each target's bit in (part of the delay between rise and fall of clock)
+			for (uint8_t _Target = 0; _Target < _Targets; _Target++) {
+
+				_In [_Target] = (_In [_Target] << 1) | (_Pins & 1);
+				_Pins >>= 1;
+
+			}
+
+			// delay between rise and fall of clock
+			delayMicroseconds (_Delay);
+
+			// clock low
+			SCK::Low ();
+
+			// delay between rise and fall of clock
+			delayMicroseconds (_Delay);
+
+		}
+
+	}
+
+	// Start (SCK low, SCK and MOSI driven)
+	static inline void Start (void) {
+
+		SCK::Low ();
+		SCK::Output ();
+		MOSI::Output ();
+
+	}
+
+	// Stop (everything back to inputs, pull-ups off)
+	static inline void Stop (void) {
+
+		SCK::Low ();
+		MOSI::Low ();
+		MISO::Low ();
+
+		SCK::Input ();
+		MOSI::Input ();
+		MISO::Input ();
+
+	}
+
+	// Hold Reset (drive RESET, level left as it was)
+	static inline void Hold_Reset (void) { Reset::Output (); }
+
+	// Release Reset (RESET low then let go, the target runs)
+	static inline void Release_Reset (void) {
+
+		Reset::Low ();
+		Reset::Input ();
+
+	}
+
+	// Pulse Reset (see "Serial Programming Algorithm" in the datasheet, at least 2 target clocks)
+	static inline void Pulse_Reset (void) {
+
+		Reset::High ();
+		delayMicroseconds (10);
+		Reset::Low ();
+
+	}
+
+};
+
+#endif
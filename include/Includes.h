@@ -1,5 +1,6 @@
 #include <SdFat.h>
 #include <EEPROM.h>
+#include <util/crc16.h>
 
 // file system object
 SdFat sd;
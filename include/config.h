@@ -3,22 +3,42 @@
 	#include <Arduino.h>
 #endif
 
-// Define Digital SPI Pins
-#define Digital_MISO_PORT  PORTB
-#define Digital_MISO_DDR   DDRB
-#define Digital_MISO_PIN   0
+// Define ISP Core
+#include "ISP_Core.h"
 
-#define Digital_MOSI_PORT  PORTB
-#define Digital_MOSI_DDR   DDRB
-#define Digital_MOSI_PIN   1
+// Define Digital SPI Pins (B100BB board profile for the ISP core, Bit_Delay in uS between clock edges)
+struct B100BB_Board {
 
-#define Digital_SCK_PORT   PORTB
-#define Digital_SCK_DDR    DDRB
-#define Digital_SCK_PIN    2
+	typedef ISP_Pin <ISP_Port_B, 2>	SCK_Pin;
+	typedef ISP_Pin <ISP_Port_B, 1>	MOSI_Pin;
+	typedef ISP_Pin <ISP_Port_B, 0>	MISO_Pin;
+	typedef ISP_Pin <ISP_Port_B, 3>	Reset_Pin;
+	static constexpr uint8_t		Bit_Delay = 6;
 
-#define Digital_Reset_PORT PORTB
-#define Digital_Reset_DDR  DDRB
-#define Digital_Reset_PIN  3
+};
+
+// Define ISP Transports (bit banged Digital SPI is always the fallback)
+#define ISP_BITBANG        0	// B100BB_Board pins above
+#define ISP_MSPIM          1	// USART0 master SPI: MOSI = TXD (PD1), MISO = RXD (PD0), SCK = XCK (PD4)
+#define ISP_HWSPI          2	// SPI port shared with the SD card, target MISO must be buffered off the bus
+
+// Select ISP Transport (set with -D ISP_TRANSPORT=... in build_flags)
+#ifndef ISP_TRANSPORT
+	#define ISP_TRANSPORT  ISP_BITBANG
+#endif
+
+// Select Read Ahead (a second page buffer so the next page is read while the target writes one, set with -D READ_AHEAD=0 or 1; by default only with more SRAM than the ATmega328P's 2 KB)
+#ifndef READ_AHEAD
+	#if defined (RAMEND) && RAMEND <= 0x8FF
+		#define READ_AHEAD 0
+	#else
+		#define READ_AHEAD 1
+	#endif
+#endif
+
+// Define MSPIM Pins
+#define MSPIM_XCK_DDR      DDRD
+#define MSPIM_XCK_PIN      4
 
 // Define Power Pins
 #define Burn_Enable_PORT   PORTB
@@ -54,4 +74,70 @@
 
 
 const char 				Firmware_Name[] 				= "FW.HEX";
+const char 				Image_Name[] 					= "FW.IMG";
+const char 				Log_Name[] 						= "FW.LOG";
+const char 				PFW_Name[] 						= "FW.PFW";
+
+// HEX Reader (largest record: length, address, type, 64 data bytes and sumcheck / chunk is a divisor of the 512 byte sector)
+const uint8_t			HEX_Record_Size					= 5 + 64;
+const uint8_t			HEX_Chunk_Size					= 64;
+
+// LED Patterns (played by the timer 1 interrupt every LED_Tick_MS, with a pause between repeats)
+const uint8_t			LED_Tick_MS						= 10;
+const uint8_t			LED_Gap_Ticks					= 1000 / LED_Tick_MS;
+
+// Compressed Firmware Container (bytes of a compressed page read at a time)
+const uint8_t			PFW_Chunk_Size					= 32;
+
+// Read Ahead (bytes of the next page read between polls while the target writes a page)
+const uint8_t			Read_Ahead_Chunk_Size			= 32;
+
+// Flashing Journal (in the programmer's EEPROM, so a session cut short is carried on by the next, see Resume_Pages)
+// session headers and progress records go round their own rings to spread the wear, a record every Journal_Pages pages
+// the EEPROM bytes are queued and written one per page, each takes 3.4 mS
+const uint8_t			Journal_Headers					= 8;
+const uint16_t			Journal_Slots					= 256;
+const uint8_t			Journal_Pages					= 8;
+const uint8_t			Journal_Done					= 0xFF;
+const uint8_t			Journal_Queue_Size				= 16;
+
+// Validation Cache (the check pass's findings for an input file that has not changed since, same size, modified time and first block, kept after the journal)
+const uint16_t			Validation_Block_Size			= 512;
+const uint8_t			Validation_Magic				= 0xA5;
+
+// Boot Size Decisions (besides the boot size fuse bits 0 to 3, see Decide_Boot_Size)
+const uint8_t			Boot_None						= 0x80;
+const uint8_t			Boot_Bad						= 0xFF;
+
+// Hardware ISP Clock (SCK = Target_Clock / ISP_Clock_Fraction at most, fraction must be over 4)
+const uint32_t			Target_Clock					= 1000000;
+const uint8_t			ISP_Clock_Fraction				= 6;
+const uint8_t			Hardware_SPI_Attempts			= 2;
+
+// ISP Speed Levels (relative to the speed each transport starts at, level 0)
+const int8_t			ISP_Slowest						= -3;
+const int8_t			ISP_Fastest						= 4;
+const uint8_t			Digital_SPI_Delays[]			= {48, 24, 12, B100BB_Board::Bit_Delay, 4, 3, 2, 0};
+const uint8_t			Slow_SPI_Attempts				= 2;
+
+// ISP Queue (instructions clocked out by the timer 2 interrupt, a power of 2, and how far a page check reads ahead)
+// an edge's interrupt takes about ISP_Edge_Cycles; only the slow clock recovery levels (below 0) are queued, and not delays that leave less than half of that for the main loop
+const uint8_t			ISP_Queue_Size					= 16;
+const uint8_t			ISP_Reads_Ahead					= ISP_Queue_Size / 2;
+const uint16_t			ISP_Edge_Cycles					= 48;
+const uint8_t			ISP_Queue_Min_Delay				= 2 * ISP_Edge_Cycles / (F_CPU / 1000000UL);
+
+// Reset Timing (wait after reset until the signature is known, pause before trying to sync again)
+const uint8_t			Reset_Settle_MS					= 20;
+const uint8_t			Resync_Pause_MS					= 100;
+
+// Give Up on a Target Still Busy After This Many Times the Datasheet Figure for the Write
+const uint8_t			Poll_Timeout_Factor				= 10;
+
+// Compare the Target Flash Before Erasing (skip erase, write and verify if it already holds the image)
+const bool				Compare_Before_Write			= true;
+
+// Verify Each Page as It Is Committed (instead of a separate verify pass)
+const bool				Verify_On_Write					= true;
+const uint8_t			Page_Write_Attempts				= 3;
 
@@ -30,14 +30,15 @@ byte lastAddressMSB = 0;
 #define MSG_VERIFICATION_ERROR					16	// verification error after programming
 #define MSG_FLASHED_OK							17	// flashed OK
 #define MSG_FLASHED_TEST						18	// flashed OK
+#define MSG_TARGET_NOT_READY					19	// target stayed busy after a write
 	
 // SPI Commands	
 #define Command_Progam_Enable					0xAC
 #define Command_Chip_Erase						0x80
 #define Command_Write_Lock_Byte					0xE0
-#define Command_Write_Low_Fuse_Byte				0xF7
-#define Command_Write_High_Fuse_Byte			0xD6
-#define Command_Write_Extended_Fuse_Byte		0xFF
+#define Command_Write_Low_Fuse_Byte				0xA0
+#define Command_Write_High_Fuse_Byte			0xA8
+#define Command_Write_Extended_Fuse_Byte		0xA4
 #define Command_Poll_Ready						0xF0
 #define Command_Program_ACK						0x53
 #define Command_Read_Signature_Byte				0x30
@@ -59,6 +60,13 @@ byte lastAddressMSB = 0;
 #define Action_Check_File						0
 #define Action_Verify_Flash						1
 #define Action_Write_To_Flash					2
+#define Action_Compare_Flash					3
+
+// Busy Kind Definitions (target writes Poll_Until_Ready waits for)
+#define Busy_Flash								0
+#define Busy_Erase								1
+#define Busy_Fuse								2
+#define Busy_Kinds								3
 
 // Fuse Definitions
 #define Low_Fuse								0
@@ -75,6 +83,32 @@ byte lastAddressMSB = 0;
 #define HEX_Extended_Linear_Addres_Record		4
 #define HEX_Start_Linear_Address_Record 		5	
 
+// HEX Decoder States
+#define HEX_State_Line_Start						0	// expecting the colon
+#define HEX_State_High_Nibble						1	// expecting the first digit of a byte
+#define HEX_State_Low_Nibble						2	// expecting the second digit of a byte
+#define HEX_State_Line_Trailer					3	// past the last digit, ignoring up to the end of the line
+
+// HEX Digit Values (0xFF if the character is not a hex digit)
+const uint8_t HEX_Nibble[256] PROGMEM = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
 // Define LED
 #define LED_No									0
 #define LED_Error								A3
@@ -87,89 +121,306 @@ typedef struct {
 	// Signature
 	uint8_t Signature [3];
 
-	// Description
+	// Description (in PROGMEM)
 	const char * Description;
 
 	// Flash Size
 	uint32_t Flash_Size;
 
+	// EEPROM Size
+	uint16_t EEPROM_Size;
+
 	// Bootloader Size
-	uint32_t Bootloader_Size;
+	uint16_t Bootloader_Size;
 
 	// Page Size
-	uint32_t Page_Size;
+	uint16_t Page_Size;
+
+	// EEPROM Page Size
+	uint8_t EEPROM_Page_Size;
 
 	// Fuse With Bootloader Size
 	uint8_t Fuse_With_Bootloader_Size;
 
+	// Fuses Present (bit Low_Fuse ... Lock_Byte)
+	uint8_t Fuse_Mask;
+
 	// Timed Writes
 	bool Timed_Writes;
 
+	// Longest Page Write, Chip Erase and Fuse Write (uS, tWD_FLASH / tWD_ERASE / tWD_FUSE)
+	uint16_t TWD_Flash;
+	uint16_t TWD_Erase;
+	uint16_t TWD_Fuse;
+
+	// Wait After Reset Before Programming Enable (mS)
+	uint8_t T_Reset;
+
 } Signature_Type;
 
 // Definitions
 #define	NO_FUSE									0xFF
+#define NO_PAGE									0xFFFFFFFF
+#define MAX_PAGE_SIZE							256
+#define IMAGE_MAGIC								0x474D4946UL	// "FIMG"
+#define PFW_MAGIC								0x31574650UL	// "PFW1"
+#define PFWZ_MAGIC								0x5A574650UL	// "PFWZ", each page compressed on its own
 
-// Fuse Definitions
-const Signature_Type Signatures[] PROGMEM = {
-
-		// Attiny84 family
-		{{0x1E, 0x91, 0x0B}, "ATtiny24", 2048, 0, 32, NO_FUSE, false},
-		{{0x1E, 0x92, 0x07}, "ATtiny44", 4096, 0, 64, NO_FUSE, false},
-		{{0x1E, 0x93, 0x0C}, "ATtiny84", 8192, 0, 64, NO_FUSE, false},
-
-		// Attiny85 family
-		{{0x1E, 0x91, 0x08}, "ATtiny25", 2048, 0, 32, NO_FUSE, false},
-		{{0x1E, 0x92, 0x06}, "ATtiny45", 4096, 0, 64, NO_FUSE, false},
-		{{0x1E, 0x93, 0x0B}, "ATtiny85", 8192, 0, 64, NO_FUSE, false},
-
-		// Atmega328 family
-		{{0x1E, 0x92, 0x0A}, "ATmega48PA", 4096, 0, 64, NO_FUSE, false},
-		{{0x1E, 0x93, 0x0F}, "ATmega88PA", 8192, 256, 128, Ext_Fuse, false},
-		{{0x1E, 0x94, 0x0B}, "ATmega168PA", 16384, 256, 128, Ext_Fuse, false},
-		{{0x1E, 0x95, 0x0F}, "ATmega328P", 32768, 512, 128, High_Fuse, false},
-
-		// Atmega644 family
-		{{0x1E, 0x94, 0x0A}, "ATmega164P", 16384, 256, 128, High_Fuse, false},
-		{{0x1E, 0x95, 0x08}, "ATmega324P", 32768, 512, 128, High_Fuse, false},
-		{{0x1E, 0x96, 0x0A}, "ATmega644P", 65536, 1024, 256, High_Fuse, false},
-
-		// Atmega2560 family
-		{{0x1E, 0x96, 0x08}, "ATmega640", 65536, 1024, 256, High_Fuse, false},
-		{{0x1E, 0x97, 0x03}, "ATmega1280", 131072, 1024, 256, High_Fuse, false},
-		{{0x1E, 0x97, 0x04}, "ATmega1281", 131072, 1024, 256, High_Fuse, false},
-		{{0x1E, 0x98, 0x01}, "ATmega2560", 262144, 1024, 256, High_Fuse, false},
-		{{0x1E, 0x98, 0x02}, "ATmega2561", 262144, 1024, 256, High_Fuse, false},
-
-		// AT90USB family
-		{{0x1E, 0x93, 0x82}, "At90USB82", 8192, 512, 128, High_Fuse, false},
-		{{0x1E, 0x94, 0x82}, "At90USB162", 16384, 512, 128, High_Fuse, false},
-
-		// Atmega32U2 family
-		{{0x1E, 0x93, 0x89}, "ATmega8U2", 8192, 512, 128, High_Fuse, false},
-		{{0x1E, 0x94, 0x89}, "ATmega16U2", 16384, 512, 128, High_Fuse, false},
-		{{0x1E, 0x95, 0x8A}, "ATmega32U2", 32768, 512, 128, High_Fuse, false},
-
-		// Atmega32U4 family -  (datasheet is wrong about flash page size being 128 words)
-		{{0x1E, 0x94, 0x88}, "ATmega16U4", 16384, 512, 128, High_Fuse, false},
-		{{0x1E, 0x95, 0x87}, "ATmega32U4", 32768, 512, 128, High_Fuse, false},
-
-		// ATmega1284P family
-		{{0x1E, 0x97, 0x05}, "ATmega1284P", 131072, 1024, 256, High_Fuse, false},
-
-		// ATtiny4313 family
-		{{0x1E, 0x91, 0x0A}, "ATtiny2313A", 2048, 0, 32, NO_FUSE, false},
-		{{0x1E, 0x92, 0x0D}, "ATtiny4313", 4096, 0, 64, NO_FUSE, false},
-
-		// ATtiny13 family
-		{{0x1E, 0x90, 0x07}, "ATtiny13A", 1024, 0, 32, NO_FUSE, false},
-
-		// Atmega8A family
-		{{0x1E, 0x93, 0x07}, "ATmega8A", 8192, 256, 64, High_Fuse, true},
-
-		// ATmega64rfr2 family
-		{{0x1E, 0xA6, 0x02}, "ATmega64rfr2", 262144, 1024, 256, High_Fuse, false},
-		{{0x1E, 0xA7, 0x02}, "ATmega128rfr2", 262144, 1024, 256, High_Fuse, false},
-		{{0x1E, 0xA8, 0x02}, "ATmega256rfr2", 262144, 1024, 256, High_Fuse, false},
-
-}; // end of signatures
\ No newline at end of file
+// Page Image Header Definitions
+typedef struct {
+
+	// Magic Number
+	uint32_t Magic;
+
+	// Page Size
+	uint32_t Page_Size;
+
+	// Page Count
+	uint16_t Page_Count;
+
+	// Lowest Address
+	uint32_t Lowest_Address;
+
+	// Highest Address
+	uint32_t Highest_Address;
+
+	// Bytes Written
+	uint32_t Bytes_Written;
+
+} Image_Header_Type;
+
+// Busy Time Definitions (how long the target stayed busy after one kind of write, uS)
+typedef struct {
+
+	// Writes Counted
+	uint16_t Count;
+
+	// Total, Shortest and Longest
+	uint32_t Total;
+	uint32_t Shortest;
+	uint32_t Longest;
+
+} Busy_Stats_Type;
+
+// Session Summary Definitions
+typedef struct {
+
+	// Pages Written
+	uint16_t Pages_Written;
+
+	// Blank Pages Skipped (neither written nor verified)
+	uint16_t Pages_Skipped;
+
+	// Pages the Target Already Held Before Erasing
+	uint16_t Pages_Matched;
+
+	// Pages a Session Cut Short Had Written (see Resume_Pages)
+	uint16_t Pages_Resumed;
+
+	// Pages Committed Again After Reading Back Wrong
+	uint16_t Pages_Retried;
+
+	// Pages Still Wrong After Page_Write_Attempts, or Never Committed
+	uint16_t Pages_Failed;
+
+	// Writes the Target Never Finished (see Poll_Until_Ready)
+	uint16_t Timeouts;
+
+	// Busy Times per Kind of Write
+	Busy_Stats_Type Busy[Busy_Kinds];
+
+	// Target Matched the Image (nothing was erased)
+	bool Unchanged;
+
+	// Input File Was Checked in an Earlier Session (see Validated_Before)
+	bool Check_Skipped;
+
+} Session_Stats_Type;
+
+// Page Image Page Map Entry Definitions
+typedef struct {
+
+	// Page Start Address
+	uint32_t Address;
+
+	// Page CRC-16 (CCITT)
+	uint16_t CRC;
+
+} Image_Page_Type;
+
+// Flashing Journal Header Definitions (one session: which image to which chip)
+typedef struct {
+
+	// CRC-32 of the Page Image's Page Map
+	uint32_t Map_CRC;
+
+	// Target Signature
+	uint8_t Signature [3];
+
+	// First Progress Record in its Ring
+	uint16_t Ring_Start;
+
+	// Sequence Number (one more than the session before, written last)
+	uint8_t Sequence;
+
+} Journal_Header_Type;
+
+// Flashing Journal Record Definitions (the first Chunks * Journal_Pages pages are written, or Journal_Done)
+typedef struct {
+
+	// Chunks Written
+	uint8_t Chunks;
+
+	// Session Sequence Number (written last)
+	uint8_t Sequence;
+
+} Journal_Record_Type;
+
+// Flashing Journal Queue Entry Definitions (an EEPROM byte waiting to be written)
+typedef struct {
+
+	// EEPROM Address
+	uint16_t Address;
+
+	// Value
+	uint8_t Value;
+
+} Journal_Byte_Type;
+
+// Validation Key Definitions (identifies the input file, and the chip it was checked for)
+typedef struct {
+
+	// File Size
+	uint32_t Size;
+
+	// Last Modified (FAT format)
+	uint16_t Date;
+	uint16_t Time;
+
+	// CRC-32 of the First Validation_Block_Size Bytes
+	uint32_t First_CRC;
+
+	// Target Signature
+	uint8_t Signature [3];
+
+	// .pfw File rather than .hex File
+	bool PFW;
+
+} Validation_Key_Type;
+
+// Validation Cache Definitions (what the check pass found out about that file)
+typedef struct {
+
+	// Key
+	Validation_Key_Type Key;
+
+	// Addresses and Size
+	uint32_t Lowest_Address;
+	uint32_t Highest_Address;
+	uint32_t Bytes_Written;
+
+	// Boot Size Decision (see Decide_Boot_Size)
+	uint8_t Boot_Size;
+
+	// Page Image Left by the Check Pass, and its Page Map CRC
+	bool Image_Ready;
+	uint32_t Image_Map_CRC;
+
+	// Validation_Magic (written last)
+	uint8_t Magic;
+
+} Validation_Type;
+
+// ISP Queue Entry Definitions (one programming instruction, see Queue_Instruction)
+typedef struct {
+
+	// Instruction Bytes (replaced by what the target sent back)
+	uint8_t Data [4];
+
+} ISP_Instruction_Type;
+
+// Firmware Container Header Definitions (.pfw file made by tools/hex2pfw, little-endian)
+typedef struct {
+
+	// Magic Number
+	uint32_t Magic;
+
+	// Target Signature
+	uint8_t Signature [3];
+
+	// Fuse Mask (bit n set if Fuses [n] is to be written)
+	uint8_t Fuse_Mask;
+
+	// Intended Fuse and Lock Bytes (Low_Fuse .. Lock_Byte)
+	uint8_t Fuses [4];
+
+	// Flash Size
+	uint32_t Flash_Size;
+
+	// Page Size
+	uint16_t Page_Size;
+
+	// Page Count
+	uint16_t Page_Count;
+
+	// Lowest Address
+	uint32_t Lowest_Address;
+
+	// Highest Address
+	uint32_t Highest_Address;
+
+	// Bytes Written
+	uint32_t Bytes_Written;
+
+	// CRC-32 of Everything After the Header
+	uint32_t Image_CRC;
+
+} PFW_Header_Type;
+
+// Firmware Container Page Entry Definitions
+typedef struct {
+
+	// Page Start Address
+	uint32_t Address;
+
+	// Page CRC-32
+	uint32_t CRC;
+
+} PFW_Page_Type;
+
+// Compressed Firmware Container Page Entry Definitions
+typedef struct {
+
+	// Page Start Address
+	uint32_t Address;
+
+	// Page CRC-32 (once decompressed)
+	uint32_t CRC;
+
+	// Compressed Bytes That Follow
+	uint32_t Length;
+
+} PFW_Packed_Page_Type;
+
+// CRC-32 of Each Nibble Value
+const uint32_t CRC32_Nibble[16] PROGMEM = {
+	0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+	0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+// Device Definitions (generated from tools/devices.conf, see devices.h)
+#include "devices.h"
+
+// Device Names
+#define Device_Name(_ID, _Sig_0, _Sig_1, _Sig_2, _Name, ...)		const char _ID##_Description [] PROGMEM = _Name;
+DEVICE_LIST (Device_Name)
+
+// Device Signatures
+#define Device_Entry(_ID, _Sig_0, _Sig_1, _Sig_2, _Name, _Flash_Size, _EEPROM_Size, _Page_Size, _EEPROM_Page_Size, _Boot_Size, _Boot_Fuse, _Fuse_Mask, _Timed_Writes, _TWD_Flash, _TWD_Erase, _TWD_Fuse, _T_Reset) \
+	{{_Sig_0, _Sig_1, _Sig_2}, _ID##_Description, _Flash_Size, _EEPROM_Size, _Boot_Size, _Page_Size, _EEPROM_Page_Size, _Boot_Fuse, _Fuse_Mask, _Timed_Writes, _TWD_Flash, _TWD_Erase, _TWD_Fuse, _T_Reset},
+
+const Signature_Type Signatures[] PROGMEM = {DEVICE_LIST (Device_Entry)};
+
+// Device Signature Keys (the signatures on their own, same sorted order, for Get_Signature)
+#define Device_Key(_ID, _Sig_0, _Sig_1, _Sig_2, ...)		{_Sig_0, _Sig_1, _Sig_2},
+const uint8_t Signature_Keys[][3] PROGMEM = {DEVICE_LIST (Device_Key)};
\ No newline at end of file
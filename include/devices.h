@@ -0,0 +1,55 @@
+// AVR parts the programmer knows about
+//
+// generated by tools/gen_devices.py from tools/devices.conf, do not edit
+//
+// DEVICE (id, signature 0, 1, 2, name, flash size, EEPROM size, flash page
+//	 size, EEPROM page size, boot size, boot fuse, fuses present, timed writes,
+//	 tWD_FLASH uS, tWD_ERASE uS, tWD_FUSE uS, reset settle mS)
+//
+// boot fuse is 0 to 2 for the low, high and extended fuse (0xFF: no
+//	bootloader section), bit 0 to 3 of fuses present stand for the low, high
+//	and extended fuse and the lock byte; timed writes is 1 for chips without
+//	Poll RDY/BSY. Each firmware expands DEVICE_LIST into its own signature
+//	table, with the names in PROGMEM.
+//
+// Sorted by signature, the firmware binary searches it.
+
+#ifndef devices_h
+#define devices_h
+
+#define DEVICE_LIST(DEVICE) \
+	DEVICE (t13a, 0x1E, 0x90, 0x07, "ATtiny13A", 1024, 64, 32, 4, 0, 0xFF, 0x0B, 0, 4500, 4000, 4500, 20) \
+	DEVICE (t25, 0x1E, 0x91, 0x08, "ATtiny25", 2048, 128, 32, 4, 0, 0xFF, 0x0F, 0, 4500, 4000, 4500, 20) \
+	DEVICE (t2313a, 0x1E, 0x91, 0x0A, "ATtiny2313A", 2048, 128, 32, 4, 0, 0xFF, 0x0F, 0, 4500, 4000, 4500, 20) \
+	DEVICE (t24, 0x1E, 0x91, 0x0B, "ATtiny24", 2048, 128, 32, 4, 0, 0xFF, 0x0F, 0, 4500, 4500, 4500, 20) \
+	DEVICE (t45, 0x1E, 0x92, 0x06, "ATtiny45", 4096, 256, 64, 4, 0, 0xFF, 0x0F, 0, 4500, 4000, 4500, 20) \
+	DEVICE (t44, 0x1E, 0x92, 0x07, "ATtiny44", 4096, 256, 64, 4, 0, 0xFF, 0x0F, 0, 4500, 4500, 4500, 20) \
+	DEVICE (m48pa, 0x1E, 0x92, 0x0A, "ATmega48PA", 4096, 256, 64, 4, 0, 0xFF, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (t4313, 0x1E, 0x92, 0x0D, "ATtiny4313", 4096, 256, 64, 4, 0, 0xFF, 0x0F, 0, 4500, 4000, 4500, 20) \
+	DEVICE (m8a, 0x1E, 0x93, 0x07, "ATmega8A", 8192, 512, 64, 4, 256, 0x01, 0x0B, 1, 4500, 9000, 4500, 20) \
+	DEVICE (t85, 0x1E, 0x93, 0x0B, "ATtiny85", 8192, 512, 64, 4, 0, 0xFF, 0x0F, 0, 4500, 4000, 4500, 20) \
+	DEVICE (t84, 0x1E, 0x93, 0x0C, "ATtiny84", 8192, 512, 64, 4, 0, 0xFF, 0x0F, 0, 4500, 4500, 4500, 20) \
+	DEVICE (m88pa, 0x1E, 0x93, 0x0F, "ATmega88PA", 8192, 512, 64, 4, 256, 0x02, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (usb82, 0x1E, 0x93, 0x82, "At90USB82", 8192, 512, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m8u2, 0x1E, 0x93, 0x89, "ATmega8U2", 8192, 512, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m164p, 0x1E, 0x94, 0x0A, "ATmega164P", 16384, 512, 128, 4, 256, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m168pa, 0x1E, 0x94, 0x0B, "ATmega168PA", 16384, 512, 128, 4, 256, 0x02, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (usb162, 0x1E, 0x94, 0x82, "At90USB162", 16384, 512, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m16u4, 0x1E, 0x94, 0x88, "ATmega16U4", 16384, 512, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m16u2, 0x1E, 0x94, 0x89, "ATmega16U2", 16384, 512, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m324p, 0x1E, 0x95, 0x08, "ATmega324P", 32768, 1024, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m328p, 0x1E, 0x95, 0x0F, "ATmega328P", 32768, 1024, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m32u4, 0x1E, 0x95, 0x87, "ATmega32U4", 32768, 1024, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m32u2, 0x1E, 0x95, 0x8A, "ATmega32U2", 32768, 1024, 128, 4, 512, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m640, 0x1E, 0x96, 0x08, "ATmega640", 65536, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m644p, 0x1E, 0x96, 0x0A, "ATmega644P", 65536, 2048, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m1280, 0x1E, 0x97, 0x03, "ATmega1280", 131072, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m1281, 0x1E, 0x97, 0x04, "ATmega1281", 131072, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m1284p, 0x1E, 0x97, 0x05, "ATmega1284P", 131072, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m2560, 0x1E, 0x98, 0x01, "ATmega2560", 262144, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m2561, 0x1E, 0x98, 0x02, "ATmega2561", 262144, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m64rfr2, 0x1E, 0xA6, 0x02, "ATmega64rfr2", 65536, 2048, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m128rfr2, 0x1E, 0xA7, 0x02, "ATmega128rfr2", 131072, 4096, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+	DEVICE (m256rfr2, 0x1E, 0xA8, 0x02, "ATmega256rfr2", 262144, 8192, 256, 8, 1024, 0x01, 0x0F, 0, 4500, 9000, 4500, 20) \
+
+#endif
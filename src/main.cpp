@@ -30,6 +30,7 @@ typedef enum {
 	MSG_UNRECOGNIZED_SIGNATURE,		   // signature not known
 	MSG_BAD_START_ADDRESS,			   // file start address invalid
 	MSG_VERIFICATION_ERROR,			   // verification error after programming
+	MSG_TARGET_NOT_READY,			   // target stayed busy after a write
 	MSG_FLASHED_OK,					   // flashed OK
 } msgType;
 
@@ -37,32 +38,181 @@ typedef enum {
 
 #include <SdFat.h>
 #include <EEPROM.h>
+#include <util/crc16.h>
+
+#include "ISP_Core.h"
 
 const char Version[] = "1.25h";
 
 const unsigned int ENTER_PROGRAMMING_ATTEMPTS = 10;
 
-// bit banged SPI pins
-const byte 				MSPIM_SCK 						= 2;
-const byte 				MSPIM_SS  						= 3;
-const byte 				BB_MISO   						= 0;
-const byte 				BB_MOSI   						= 1;
-#define BB_MISO_PORT PIND
-#define BB_MOSI_PORT PORTD
-#define BB_SCK_PORT PORTD
-const byte 				BB_SCK_BIT 						= 2;
-const byte 				BB_MISO_BIT 					= 0;
-const byte 				BB_MOSI_BIT 					= 1;
-const byte 				RESET 							= MSPIM_SS;
-
-
-
-
-// control speed of programming
-const byte BB_DELAY_MICROSECONDS = 6;
+// ISP transports, select one with -D ISP_TRANSPORT=... in build_flags
+//  the bit banged transport is always available as a fallback
+#define ISP_BITBANG 0 // any pins, see BB_* below
+#define ISP_MSPIM 1	  // USART0 in master SPI mode: MOSI = TXD (D1), MISO = RXD (D0), SCK = XCK (D4)
+#define ISP_HWSPI 2	  // SPI port shared with the SD card (D11/D12/D13), target MISO must be buffered off the bus
+#define ISP_HOST 3	  // simulated target in a host build, see tools/host/sim_transport.h
+
+#ifndef ISP_TRANSPORT
+#define ISP_TRANSPORT ISP_BITBANG
+#endif
+
+// hardware transports run SCK at (at most) this fraction of the target clock,
+//  which has to be more than 4 (see "Serial Programming" in the datasheet)
+const unsigned long TARGET_CLOCK = 1000000; // factory default: 8 MHz RC oscillator / 8
+const byte ISP_CLOCK_FRACTION = 6;
+const unsigned long ISP_SCK = TARGET_CLOCK / ISP_CLOCK_FRACTION;
+
+// MSPIM clock is F_CPU / (2 * (UBRR0 + 1)), round the divider up
+const unsigned int MSPIM_UBRR = (F_CPU / 2 + ISP_SCK - 1) / ISP_SCK - 1;
+const byte MSPIM_XCK = 4;
+
+// attempts with a hardware transport before falling back to bit banging
+const unsigned int HW_PROGRAMMING_ATTEMPTS = 2;
+
+// gang programming: up to 8 identical targets share SCK, MOSI and RESET,
+//  each answers on its own MISO, select with -D GANG_TARGETS=... in
+//  build_flags (bit banged only, or ISP_HOST)
+#ifndef GANG_TARGETS
+#define GANG_TARGETS 1
+#endif
+
+// read the next page of the page image or .pfw file while the target writes
+//  one (see nextPage), at the cost of a second page buffer; select with
+//  -D READ_AHEAD=0 or 1 in build_flags, by default only where there is more
+//  SRAM than the ATmega328P's 2 KB (beside SdFat's cache and the ISP queue
+//  the 256 bytes would leave too little stack)
+#ifndef READ_AHEAD
+#if defined(RAMEND) && RAMEND <= 0x8FF
+#define READ_AHEAD 0
+#else
+#define READ_AHEAD 1
+#endif
+#endif
+
+#if GANG_TARGETS < 1 || GANG_TARGETS > 8
+#error GANG_TARGETS must be 1 to 8
+#endif
+#if GANG_TARGETS > 1 && ISP_TRANSPORT != ISP_BITBANG && ISP_TRANSPORT != ISP_HOST
+#error gang programming needs the bit banged transport
+#endif
+
+#if GANG_TARGETS > 1
+// gang wiring (A0 = SCK, A4 = MOSI, A5 = RESET, target n's MISO on Dn, all
+//  read at once), the delay as below
+struct BB_Board
+{
+	typedef ISP_Pin<ISP_Port_C, 0> SCK_Pin;
+	typedef ISP_Pin<ISP_Port_C, 4> MOSI_Pin;
+	typedef ISP_Pin<ISP_Port_D, 0> MISO_Pin; // target 0
+	typedef ISP_Pin<ISP_Port_C, 5> Reset_Pin;
+	typedef ISP_Port_D Gang_MISO_Port;
+	static constexpr byte Bit_Delay = 6;
+};
+#else
+// bit banged SPI wiring (D2 = SCK, D1 = MOSI, D0 = MISO, D3 = RESET) and the
+//  delay between clock edges, in microseconds, that controls its speed
+struct BB_Board
+{
+	typedef ISP_Pin<ISP_Port_D, 2> SCK_Pin;
+	typedef ISP_Pin<ISP_Port_D, 1> MOSI_Pin;
+	typedef ISP_Pin<ISP_Port_D, 0> MISO_Pin;
+	typedef ISP_Pin<ISP_Port_D, 3> Reset_Pin;
+	static constexpr byte Bit_Delay = 6;
+};
+#endif
+
+// also drives RESET, whichever transport carries the data
+typedef ISP_Core<BB_Board> BB_ISP;
+
+// ISP speed levels, relative to the speed each transport starts at (level 0):
+//  startProgramming goes slower until the target answers, then probes faster
+//  levels and locks in one step below the fastest that still works
+const int8_t ISP_SLOWEST = -3;
+const int8_t ISP_FASTEST = 4;
+const byte BB_DELAYS[ISP_FASTEST - ISP_SLOWEST + 1] = {48, 24, 12, BB_Board::Bit_Delay, 4, 3, 2, 0};
+
+// attempts at each level below 0 before giving up
+const unsigned int SLOW_PROGRAMMING_ATTEMPTS = 2;
+
+// ISP instructions that can wait to be clocked out in the background (a
+//  power of 2), and how far the flash reads of a page check run ahead of
+//  the comparisons (leaves room for a load extended address)
+const byte ISP_QUEUE_SIZE = 16;
+const byte ISP_READS_AHEAD = ISP_QUEUE_SIZE / 2;
+
+// the interrupt for one SCK edge takes about ISP_EDGE_CYCLES, entry and
+//  exit included; instructions are only queued at the slow clock recovery
+//  levels (below 0), and only when that leaves at least half of each bit
+//  delay for the main loop, else they are sent straight away: from level 0
+//  up the delays are too short to leave the main loop anything worth having
+const unsigned int ISP_EDGE_CYCLES = 48;
+const byte ISP_QUEUE_MIN_DELAY = 2 * ISP_EDGE_CYCLES / (F_CPU / 1000000UL);
+
+// wait after pulsing reset until the signature (and so the chip's own
+//  figure) is known, and the pause before trying to sync again
+const byte RESET_SETTLE_MS = 20;
+const byte RESYNC_PAUSE_MS = 100;
+
+// give up on a target that is still busy after this many times the
+//  datasheet figure for the write
+const byte POLL_TIMEOUT_FACTOR = 10;
 
 const unsigned long NO_PAGE = 0xFFFFFFFF;
-const int MAX_FILENAME = 13;
+
+// read the target's flash before erasing it, and skip the erase, write and
+//  verify altogether if it already holds the image
+const bool COMPARE_BEFORE_WRITE = true;
+
+// read each page back as soon as it is committed, while it is still in
+//  pageBuffer, instead of a separate verify pass over the whole file
+const bool VERIFY_ON_WRITE = true;
+
+// times to load and commit a page that does not read back correctly
+const byte PAGE_WRITE_ATTEMPTS = 3;
+
+// largest flash page of any chip in the signatures table
+const unsigned int MAX_PAGE_SIZE = 256;
+
+// summary of each session is appended to this file
+const char logFile[] = "/fw.log";
+
+// binary page image written by the check pass, so that the write and verify
+//  passes can stream it instead of parsing the .hex file again
+const char imageFile[] = "/fw.img";
+const unsigned long IMAGE_MAGIC = 0x474D4946; // "FIMG"
+
+// precompiled firmware container (made by tools/hex2pfw), used instead of
+//  the .hex file when it is on the card
+const char pfwFile[] = "/fw.pfw";
+const unsigned long PFW_MAGIC = 0x31574650;	 // "PFW1"
+const unsigned long PFWZ_MAGIC = 0x5A574650; // "PFWZ", each page compressed on its own
+
+// bytes of a compressed page read from the .pfw file at a time
+const byte PFW_CHUNK_SIZE = 32;
+
+// bytes read ahead between polls while the target writes a page, small
+//  enough that the target is not left waiting long once it is done
+const byte READ_AHEAD_CHUNK = 32;
+
+// a journal in the programmer's EEPROM records which image is going to
+//  which chip and how far the write got, so that a session cut short (a
+//  brown out) is carried on by the next one instead of erasing again
+// session headers and progress records each go round their own ring, to
+//  spread the wear; a record is written every JOURNAL_PAGES pages
+const byte JOURNAL_HEADERS = 8;
+const unsigned int JOURNAL_SLOTS = 256;
+const byte JOURNAL_PAGES = 8;
+const byte JOURNAL_DONE = 0xFF; // progress record of a finished session
+// an EEPROM byte takes 3.4 mS to write, so they are queued and written one
+//  per page rather than waiting for each
+const byte JOURNAL_QUEUE = 16;
+
+// what the check pass found out about the input file is kept in EEPROM
+//  after the journal, so a file that has not changed since (same size,
+//  modified time and first block) is not checked again
+const unsigned int VALIDATION_BLOCK = 512;
+const byte VALIDATION_MAGIC = 0xA5; // written last, 0 while being written
 
 
 // actions to take
@@ -71,6 +221,7 @@ enum
 	checkFile,
 	verifyFlash,
 	writeToFlash,
+	compareFlash, // read the target before erasing it, see comparePage
 };
 
 // file system object
@@ -93,87 +244,90 @@ enum
 typedef struct
 {
 	byte sig[3];
-	const char *desc;
+	const char *desc;			 // in PROGMEM
 	unsigned long flashSize;
+	unsigned int eepromSize;
 	unsigned int baseBootSize;
-	unsigned long pageSize;		 // bytes
+	unsigned int pageSize;		 // bytes
+	byte eepromPageSize;
 	byte fuseWithBootloaderSize; // ie. one of: lowFuse, highFuse, extFuse
+	byte fuseMask;				 // bit(lowFuse) ... bit(lockByte) for those the chip has
 	byte timedWrites;			 // if pollUntilReady won't work by polling the chip
+	unsigned int tWDFlash;		 // longest page write, uS (tWD_FLASH)
+	unsigned int tWDErase;		 // longest chip erase, uS (tWD_ERASE)
+	unsigned int tWDFuse;		 // longest fuse / lock byte write, uS (tWD_FUSE)
+	byte tReset;				 // wait after reset before programming enable, mS
 } signatureType;
 
-const unsigned long kb = 1024;
 const byte NO_FUSE = 0xFF;
 
-// see Atmega datasheets
-const signatureType signatures[] PROGMEM =
-	{
-		//     signature        description   flash size   bootloader  flash  fuse
-		//                                                     size    page    to
-		//                                                             size   change
-
-		// Attiny84 family
-		{{0x1E, 0x91, 0x0B}, "ATtiny24", 2 * kb, 0, 32, NO_FUSE, false},
-		{{0x1E, 0x92, 0x07}, "ATtiny44", 4 * kb, 0, 64, NO_FUSE, false},
-		{{0x1E, 0x93, 0x0C}, "ATtiny84", 8 * kb, 0, 64, NO_FUSE, false},
-
-		// Attiny85 family
-		{{0x1E, 0x91, 0x08}, "ATtiny25", 2 * kb, 0, 32, NO_FUSE, false},
-		{{0x1E, 0x92, 0x06}, "ATtiny45", 4 * kb, 0, 64, NO_FUSE, false},
-		{{0x1E, 0x93, 0x0B}, "ATtiny85", 8 * kb, 0, 64, NO_FUSE, false},
-
-		// Atmega328 family
-		{{0x1E, 0x92, 0x0A}, "ATmega48PA", 4 * kb, 0, 64, NO_FUSE, false},
-		{{0x1E, 0x93, 0x0F}, "ATmega88PA", 8 * kb, 256, 128, extFuse, false},
-		{{0x1E, 0x94, 0x0B}, "ATmega168PA", 16 * kb, 256, 128, extFuse, false},
-		{{0x1E, 0x95, 0x0F}, "ATmega328P", 32 * kb, 512, 128, highFuse, false},
-
-		// Atmega644 family
-		{{0x1E, 0x94, 0x0A}, "ATmega164P", 16 * kb, 256, 128, highFuse, false},
-		{{0x1E, 0x95, 0x08}, "ATmega324P", 32 * kb, 512, 128, highFuse, false},
-		{{0x1E, 0x96, 0x0A}, "ATmega644P", 64 * kb, 1 * kb, 256, highFuse, false},
-
-		// Atmega2560 family
-		{{0x1E, 0x96, 0x08}, "ATmega640", 64 * kb, 1 * kb, 256, highFuse, false},
-		{{0x1E, 0x97, 0x03}, "ATmega1280", 128 * kb, 1 * kb, 256, highFuse, false},
-		{{0x1E, 0x97, 0x04}, "ATmega1281", 128 * kb, 1 * kb, 256, highFuse, false},
-		{{0x1E, 0x98, 0x01}, "ATmega2560", 256 * kb, 1 * kb, 256, highFuse, false},
+// the chips themselves are in devices.h, generated from tools/devices.conf
+#include "devices.h"
 
-		{{0x1E, 0x98, 0x02}, "ATmega2561", 256 * kb, 1 * kb, 256, highFuse, false},
+#define DEVICE_NAME(id, sig0, sig1, sig2, name, ...) const char id##Name[] PROGMEM = name;
+#define DEVICE_ENTRY(id, sig0, sig1, sig2, name, flashSize, eepromSize, pageSize, eepromPageSize, bootSize, \
+					 bootFuse, fuseMask, timedWrites, tWDFlash, tWDErase, tWDFuse, tReset)            \
+	{{sig0, sig1, sig2}, id##Name, flashSize, eepromSize, bootSize, pageSize, eepromPageSize,            \
+	 bootFuse, fuseMask, timedWrites, tWDFlash, tWDErase, tWDFuse, tReset},
 
-		// AT90USB family
-		{{0x1E, 0x93, 0x82}, "At90USB82", 8 * kb, 512, 128, highFuse, false},
-		{{0x1E, 0x94, 0x82}, "At90USB162", 16 * kb, 512, 128, highFuse, false},
+DEVICE_LIST(DEVICE_NAME)
 
-		// Atmega32U2 family
-		{{0x1E, 0x93, 0x89}, "ATmega8U2", 8 * kb, 512, 128, highFuse, false},
-		{{0x1E, 0x94, 0x89}, "ATmega16U2", 16 * kb, 512, 128, highFuse, false},
-		{{0x1E, 0x95, 0x8A}, "ATmega32U2", 32 * kb, 512, 128, highFuse, false},
+const signatureType signatures[] PROGMEM = {DEVICE_LIST(DEVICE_ENTRY)};
 
-		// Atmega32U4 family -  (datasheet is wrong about flash page size being 128 words)
-		{{0x1E, 0x94, 0x88}, "ATmega16U4", 16 * kb, 512, 128, highFuse, false},
-		{{0x1E, 0x95, 0x87}, "ATmega32U4", 32 * kb, 512, 128, highFuse, false},
+// the signatures on their own, in the same (sorted) order, for getSignature
+#define DEVICE_KEY(id, sig0, sig1, sig2, ...) {sig0, sig1, sig2},
 
-		// ATmega1284P family
-		{{0x1E, 0x97, 0x05}, "ATmega1284P", 128 * kb, 1 * kb, 256, highFuse, false},
+const byte signatureKeys[][3] PROGMEM = {DEVICE_LIST(DEVICE_KEY)};
 
-		// ATtiny4313 family
-		{{0x1E, 0x91, 0x0A}, "ATtiny2313A", 2 * kb, 0, 32, NO_FUSE, false},
-		{{0x1E, 0x92, 0x0D}, "ATtiny4313", 4 * kb, 0, 64, NO_FUSE, false},
-
-		// ATtiny13 family
-		{{0x1E, 0x90, 0x07}, "ATtiny13A", 1 * kb, 0, 32, NO_FUSE, false},
-
-		// Atmega8A family
-		{{0x1E, 0x93, 0x07}, "ATmega8A", 8 * kb, 256, 64, highFuse, true},
-
-		// ATmega64rfr2 family
-		{{0x1E, 0xA6, 0x02}, "ATmega64rfr2", 256 * kb, 1 * kb, 256, highFuse, false},
-		{{0x1E, 0xA7, 0x02}, "ATmega128rfr2", 256 * kb, 1 * kb, 256, highFuse, false},
-		{{0x1E, 0xA8, 0x02}, "ATmega256rfr2", 256 * kb, 1 * kb, 256, highFuse, false},
+// start of the page image file
+typedef struct
+{
+	unsigned long magic;
+	unsigned long pageSize;
+	unsigned int pageCount;
+	unsigned long lowestAddress;
+	unsigned long highestAddress;
+	unsigned long bytesWritten;
+} imageHeaderType;
+
+// precedes each page in the image file, together these make up the page map
+typedef struct
+{
+	unsigned long addr; // byte address of the start of the page
+	unsigned int crc;	// CRC-16 (CCITT) of the page data
+} imagePageType;
 
-}; // end of signatures
+// start of the .pfw file, all numbers little-endian (fixed width types,
+//  the file is made on the build server)
+typedef struct
+{
+	uint32_t magic;
+	uint8_t sig[3];			 // target signature
+	uint8_t fuseMask;		 // bit n set if fuses[n] (lowFuse .. lockByte) is to be written
+	uint8_t fuses[4];		 // intended fuse and lock bytes
+	uint32_t flashSize;		 // of the target, bytes
+	uint16_t pageSize;		 // bytes
+	uint16_t pageCount;		 // entries that follow
+	uint32_t lowestAddress;
+	uint32_t highestAddress;
+	uint32_t bytesWritten;	 // data bytes in the original .hex file
+	uint32_t imageCRC;		 // CRC-32 of everything after the header
+} pfwHeaderType;
+
+// precedes each page in the .pfw file, pages are in address order
+typedef struct
+{
+	uint32_t addr; // byte address of the start of the page
+	uint32_t crc;  // CRC-32 of the page data
+} pfwPageType;
 
-char name[MAX_FILENAME] = {0}; // current file name
+// precedes each page in a compressed (PFWZ) .pfw file
+typedef struct
+{
+	uint32_t addr;	 // byte address of the start of the page
+	uint32_t crc;	 // CRC-32 of the page data, once decompressed
+	uint32_t length; // bytes of compressed data that follow
+} pfwPackedPageType;
 
 // number of items in an array
 #define NUMITEMS(arg) ((unsigned int)(sizeof(arg) / sizeof(arg[0])))
@@ -227,36 +381,143 @@ enum
 	hexStartLinearAddressRecord		 // 05
 };
 
+// value of each character as a hex digit, or 0xFF if it isn't one
+const byte hexNibble[256] PROGMEM =
+	{
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+		0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+}; // end of hexNibble
+
+// CRC-32 (as used by zip) of each value of a nibble
+const uint32_t crc32Nibble[16] PROGMEM =
+	{
+		0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+		0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+		0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+		0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+}; // end of crc32Nibble
+
 
 volatile boolean fired = false;
 
+// LED patterns are played in the background by the timer 1 interrupt, this often
+const unsigned long LED_TICK_MS = 10;
+const unsigned int LED_GAP_TICKS = 1000 / LED_TICK_MS; // pause between repeats
+
+// pattern being played, see blink
+volatile int ledPattern1 = noLED;
+volatile int ledPattern2 = noLED;
+volatile byte ledTimes;				   // blinks in each sequence
+volatile unsigned int ledInterval;	   // ticks on, then off
+volatile byte ledBlinksLeft;		   // in this sequence
+volatile unsigned long ledRepeatsLeft; // sequences to go, 0 once finished
+volatile unsigned int ledTicks;		   // until the next change
+volatile bool ledLit;
+
+// message being shown by ShowMessage
+volatile byte ledMessage = 0xFF;
+
+// play one step of the LED pattern
+ISR(TIMER1_COMPA_vect)
+{
+	if (ledRepeatsLeft == 0 || --ledTicks > 0)
+		return; // nothing playing, or not time yet
+
+	ledLit = !ledLit;
+	digitalWrite(ledPattern1, ledLit);
+	if (ledPattern2 != noLED)
+		digitalWrite(ledPattern2, ledLit);
+	ledTicks = ledInterval;
+
+	if (ledLit || --ledBlinksLeft > 0)
+		return;
+
+	// end of a sequence, wait a second and do it again
+	if (--ledRepeatsLeft > 0)
+	{
+		ledBlinksLeft = ledTimes;
+		ledTicks += LED_GAP_TICKS;
+	}
+} // end of TIMER1_COMPA_vect
+
+// tick every LED_TICK_MS, timer 1 is otherwise only used for PWM
+void startLEDTimer()
+{
+	TCCR1A = 0;
+	TCCR1B = bit(WGM12) | bit(CS11) | bit(CS10); // CTC, F_CPU / 64
+	OCR1A = F_CPU / 64 / (1000 / LED_TICK_MS) - 1;
+	TIMSK1 = bit(OCIE1A);
+} // end of startLEDTimer
+
+// true while a pattern is still playing
+bool blinking()
+{
+	return ledRepeatsLeft > 0;
+} // end of blinking
+
 // blink one or two LEDs for "times" times, with a delay of "interval". Wait a second and do it again "repeat" times.
+//  returns straight away, the pattern plays in the background and replaces any earlier one
 void blink(const int whichLED1,
 		   const int whichLED2,
 		   const byte times = 1,
 		   const unsigned long repeat = 1,
 		   const unsigned long interval = 200)
 {
-	for (unsigned long i = 0; i < repeat; i++)
+	noInterrupts();
+
+	// put out whatever the last pattern left on
+	if (ledLit)
 	{
-		for (byte j = 0; j < times; j++)
-		{
-			digitalWrite(whichLED1, HIGH);
-			if (whichLED2 != noLED)
-				digitalWrite(whichLED2, HIGH);
-			delay(interval);
-			digitalWrite(whichLED1, LOW);
-			if (whichLED2 != noLED)
-				digitalWrite(whichLED2, LOW);
-			delay(interval);
-		} // end of for loop
-		if (i < (repeat - 1))
-			delay(1000);
-	} // end of repeating the sequence
+		digitalWrite(ledPattern1, LOW);
+		if (ledPattern2 != noLED)
+			digitalWrite(ledPattern2, LOW);
+	}
+
+	ledPattern1 = whichLED1;
+	ledPattern2 = whichLED2;
+	ledTimes = ledBlinksLeft = times;
+	ledInterval = max(interval / LED_TICK_MS, 1UL);
+	ledRepeatsLeft = times > 0 ? repeat : 0;
+	ledTicks = 1; // first LED on at the next tick
+	ledLit = false;
+
+	interrupts();
 } // end of blink
 
+// true for the messages loop() shows while it waits for something to do
+//  (no card, no file, no target), as against the outcome of a session
+bool waitingMessage(const byte which)
+{
+	return which == MSG_NO_SD_CARD || which == MSG_CANNOT_OPEN_FILE ||
+		   which == MSG_CANNOT_ENTER_PROGRAMMING_MODE || which == MSG_CANNOT_FIND_SIGNATURE;
+} // end of waitingMessage
+
 void ShowMessage(const byte which)
 {
+	// already showing it? let it carry on rather than start again
+	if (which == ledMessage && blinking())
+		return;
+
+	// a session's OK or error plays out before waiting is shown again (the
+	//  next pass of loop() finds fw.hex gone after a flash, for one)
+	if (blinking() && waitingMessage(which) && !waitingMessage(ledMessage))
+		return;
+	ledMessage = which;
+
 	// first turn off all LEDs
 	digitalWrite(errorLED, LOW);
 	digitalWrite(workingLED, LOW);
@@ -323,48 +584,428 @@ void ShowMessage(const byte which)
 	case MSG_VERIFICATION_ERROR:
 		blink(errorLED, noLED, 8, 5);
 		break;
+	case MSG_TARGET_NOT_READY:
+		blink(errorLED, noLED, 9, 5);
+		break;
 	case MSG_FLASHED_OK:
 		blink(readyLED, noLED, 3, 10);
 		break;
 
 	default:
-		blink(errorLED, 10, 10);
+		blink(errorLED, noLED, 10, 10);
 		break; // unknown error
 	}		   // end of switch on which message
 } // end of ShowMessage
 
+// delay between clock edges, set by setISPSpeed
+byte bbDelay = BB_Board::Bit_Delay;
+
+// speed level in use, set by setISPSpeed
+int8_t ispSpeed = 0;
+bool ispSpeedLocked = false; // negotiated with the current target
+
+#if GANG_TARGETS > 1
+// targets still in the session, bit n for target n, see dropTargets
+byte gangActive;
+byte gangLead; // lowest of them, whose answers program() returns
+
+// what each target sent back with the last byte
+byte gangIn[GANG_TARGETS];
+
+// Bit Banged SPI transfer, to every target at once
+byte BB_SPITransfer(byte c)
+{
+	BB_ISP::Gang_Transfer<BB_Board::Gang_MISO_Port>(c, gangIn, GANG_TARGETS, bbDelay);
+	return gangIn[gangLead];
+} // end of BB_SPITransfer
+#else
 // Bit Banged SPI transfer
 byte BB_SPITransfer(byte c)
 {
-	byte bit;
+	return BB_ISP::Transfer(c, bbDelay);
+} // end of BB_SPITransfer
+#endif
+
+#if ISP_TRANSPORT == ISP_HOST
+// tools/host/sim_transport.cpp, clocked like the bit banged transport
+byte hostSPITransfer(byte c);
+byte hostGangTransfer(byte c, byte *in, byte targets);
+
+#if GANG_TARGETS > 1
+byte hostGangSPITransfer(byte c)
+{
+	hostGangTransfer(c, gangIn, GANG_TARGETS);
+	return gangIn[gangLead];
+} // end of hostGangSPITransfer
+#endif
+#endif
+
+// why a target left the session, for the log
+enum
+{
+	gangOK,
+	gangNoTarget,  // never entered programming mode
+	gangSignature, // not the same chip as the lead
+	gangNotReady,  // a write never finished
+	gangVerify,	   // a page still read back wrong after PAGE_WRITE_ATTEMPTS
+	gangFuses,	   // fuse or lock bytes not as the lead's
+};
+
+#if GANG_TARGETS > 1
+byte gangResult[GANG_TARGETS];
+
+// every target back in, at the start of a session
+void startGang()
+{
+	gangActive = (1 << GANG_TARGETS) - 1;
+	gangLead = 0;
+	memset(gangResult, gangOK, sizeof gangResult);
+} // end of startGang
+
+// targets still in the session whose answer in "in", masked, was "expected"
+byte answeringFrom(const byte *in, const byte expected, const byte mask)
+{
+	byte which = 0;
+	for (byte t = 0; t < GANG_TARGETS; t++)
+		if ((gangActive & bit(t)) && (in[t] & mask) == expected)
+			which |= bit(t);
+	return which;
+} // end of answeringFrom
+
+// targets whose last byte, masked, was "expected" ("answer" is the lead's)
+byte answering(const byte answer, const byte expected, const byte mask = 0xFF)
+{
+	(void)answer;
+	return answeringFrom(gangIn, expected, mask);
+} // end of answering
+
+// take "which" out of the session for "reason", the others carry on,
+//  returns false if none are left
+// RESET, SCK and MOSI are shared, so a dropped target that is still in
+//  programming mode goes on getting every erase, page and fuse write the
+//  lead does: fine for the same chip (it gets the same image), which is why
+//  getSignature ends the session rather than drop a different one
+bool dropTargets(const byte which, const byte reason)
+{
+	for (byte t = 0; t < GANG_TARGETS; t++)
+		if (gangActive & which & bit(t))
+			gangResult[t] = reason;
+	gangActive &= ~which;
+	if (gangActive == 0)
+		return false;
+
+	for (gangLead = 0; (gangActive & bit(gangLead)) == 0; gangLead++)
+		;
+	return true;
+} // end of dropTargets
+
+// false, with a message, if a target that entered programming mode dropped
+//  out: the session did not program the whole gang
+bool gangComplete()
+{
+	for (byte t = 0; t < GANG_TARGETS; t++)
+		if (gangResult[t] != gangOK && gangResult[t] != gangNoTarget)
+		{
+			ShowMessage(gangResult[t] == gangNotReady ? MSG_TARGET_NOT_READY : MSG_VERIFICATION_ERROR);
+			return false;
+		} // end of target dropped
+	return true;
+} // end of gangComplete
+#else
+// one target, see the gang versions above
+const byte gangActive = 1;
+
+void startGang()
+{
+} // end of startGang
+
+byte answering(const byte answer, const byte expected, const byte mask = 0xFF)
+{
+	return (answer & mask) == expected;
+} // end of answering
+
+// nothing to carry on with
+bool dropTargets(const byte which, const byte reason)
+{
+	(void)which;
+	(void)reason;
+	return false;
+} // end of dropTargets
+
+bool gangComplete()
+{
+	return true;
+} // end of gangComplete
+#endif
+
+#if ISP_TRANSPORT == ISP_MSPIM
+// USART0 in master SPI mode (SPI mode 0, MSB first)
+void MSPIM_start()
+{
+	UBRR0 = 0;
+	pinMode(MSPIM_XCK, OUTPUT); // XCK is SCK
+	UCSR0C = bit(UMSEL00) | bit(UMSEL01);
+	UCSR0B = bit(TXEN0) | bit(RXEN0);
+	UBRR0 = MSPIM_UBRR; // must be set after the transmitter is enabled
+} // end of MSPIM_start
+
+void MSPIM_stop()
+{
+	UCSR0B = 0;
+	UCSR0C = 0;
+	pinMode(MSPIM_XCK, INPUT);
+} // end of MSPIM_stop
 
-	for (bit = 0; bit < 8; bit++)
+byte MSPIM_SPITransfer(byte c)
+{
+	while ((UCSR0A & bit(UDRE0)) == 0)
 	{
-		// write MOSI on falling edge of previous clock
-		if (c & 0x80)
-			BB_MOSI_PORT |= bit(BB_MOSI_BIT);
-		else
-			BB_MOSI_PORT &= ~bit(BB_MOSI_BIT);
-		c <<= 1;
+	} // wait for room in the transmit buffer
+	UDR0 = c;
+	while ((UCSR0A & bit(RXC0)) == 0)
+	{
+	} // wait for the byte clocked in at the same time
+	return UDR0;
+} // end of MSPIM_SPITransfer
+#endif // ISP_TRANSPORT == ISP_MSPIM
+
+#if ISP_TRANSPORT == ISP_HWSPI
+byte HW_SPIControl;
+byte HW_SPIStatus;
+byte HW_SPIBaseRate;
+
+// rate n divides F_CPU by 2^(n+1)
+void HW_SPIRate(const byte rate)
+{
+	HW_SPIControl = bit(SPE) | bit(MSTR) | (rate / 2); // SPR1:SPR0
+	HW_SPIStatus = (rate < 6 && (rate & 1) == 0) ? bit(SPI2X) : 0;
+} // end of HW_SPIRate
+
+// work out the SPI clock divider, the bus itself was set up by sd.begin
+void HW_SPIStart()
+{
+	// take the fastest rate not above ISP_SCK
+	byte rate = 0;
+	for (unsigned long sck = F_CPU / 2; sck > ISP_SCK && rate < 6; sck /= 2)
+		rate++;
+
+	HW_SPIBaseRate = rate;
+	HW_SPIRate(rate);
+} // end of HW_SPIStart
 
-		// read MISO
-		c |= (BB_MISO_PORT & bit(BB_MISO_BIT)) != 0;
+byte HW_SPITransfer(byte c)
+{
+	// SdFat sets its own clock on the shared bus, so put ours back each time
+	SPCR = HW_SPIControl;
+	SPSR = HW_SPIStatus;
+	SPDR = c;
+	while ((SPSR & bit(SPIF)) == 0)
+	{
+	} // wait for transfer to finish
+	return SPDR;
+} // end of HW_SPITransfer
+#endif // ISP_TRANSPORT == ISP_HWSPI
+
+// transport in use, set by startTransport
+byte ispTransport = ISP_BITBANG;
+byte (*ispTransfer)(byte c) = BB_SPITransfer;
+
+// work to get on with while the target is busy writing, or the ISP queue is
+//  full, a step at a time (see readAheadChunk), returns true once there is
+//  no more
+bool (*busyWork)() = NULL;
+
+// run one step of busyWork, if there is any
+void doBusyWork()
+{
+	if (busyWork != NULL && busyWork())
+		busyWork = NULL;
+} // end of doBusyWork
+
+// instructions waiting to be clocked out, one SCK edge per timer 2 compare
+//  match, so the bit delays of the bit banged transport are free for the
+//  main loop at the slow clock recovery levels; the other transports (and
+//  bit banging from level 0 up, or to a gang) send each one straight away
+// sequence numbers count up from 0 and wrap, slot is number % ISP_QUEUE_SIZE
+typedef struct
+{
+	byte b[4]; // the instruction, replaced by what the target sent back
+#if GANG_TARGETS > 1
+	byte gang[GANG_TARGETS]; // what each target sent back on the 4th byte
+#endif
+} ispInstructionType;
+
+ispInstructionType ispQueue[ISP_QUEUE_SIZE];
+volatile byte ispQueueHead; // next to be queued, changed by the main loop only
+volatile byte ispQueueTail; // next to be sent, changed by the interrupt only
+
+// where the interrupt is in the instruction at the tail
+byte ispQueueByte;	   // 0 to 3
+byte ispQueueBitsLeft; // of that byte, 0 before it is started
+byte ispQueueShift;	   // bits going out, coming in
+bool ispQueueSCKHigh;
+
+// one SCK edge: on the rising edge put out MOSI and read MISO, as
+//  ISP_Core::Transfer does
+ISR(TIMER2_COMPA_vect)
+{
+	ispInstructionType &instruction = ispQueue[ispQueueTail % ISP_QUEUE_SIZE];
 
-		// clock high
-		BB_SCK_PORT |= bit(BB_SCK_BIT);
+	if (ispQueueSCKHigh)
+	{
+		BB_ISP::SCK::Low();
+		ispQueueSCKHigh = false;
+		if (--ispQueueBitsLeft > 0)
+			return;
 
-		// delay between rise and fall of clock
-		delayMicroseconds(BB_DELAY_MICROSECONDS);
+		// byte done, keep what came back
+		instruction.b[ispQueueByte] = ispQueueShift;
+		if (++ispQueueByte < 4)
+			return;
 
-		// clock low
-		BB_SCK_PORT &= ~bit(BB_SCK_BIT);
+		// instruction done, stop once there are no more
+		ispQueueByte = 0;
+		if (++ispQueueTail == ispQueueHead)
+			TIMSK2 &= ~bit(OCIE2A);
+		return;
+	} // end of falling edge
 
-		// delay between rise and fall of clock
-		delayMicroseconds(BB_DELAY_MICROSECONDS);
+	if (ispQueueBitsLeft == 0)
+	{
+		ispQueueShift = instruction.b[ispQueueByte];
+		ispQueueBitsLeft = 8;
 	}
 
-	return c;
-} // end of BB_SPITransfer
+	if (ispQueueShift & 0x80)
+		BB_ISP::MOSI::High();
+	else
+		BB_ISP::MOSI::Low();
+	ispQueueShift = (ispQueueShift << 1) | BB_ISP::MISO::Read();
+	BB_ISP::SCK::High();
+	ispQueueSCKHigh = true;
+} // end of TIMER2_COMPA_vect
+
+// compare match every bbDelay uS (the interrupt itself adds to that)
+void setISPQueueSpeed()
+{
+	OCR2A = max(bbDelay * (F_CPU / 8 / 1000000UL), 1UL) - 1;
+} // end of setISPQueueSpeed
+
+// timer 2 in CTC mode at F_CPU / 8, the interrupt is enabled while the
+//  queue holds something
+void startISPQueue()
+{
+	TIMSK2 = 0;
+	ispQueueHead = ispQueueTail = 0;
+	ispQueueByte = ispQueueBitsLeft = 0;
+	ispQueueSCKHigh = false;
+	TCCR2A = bit(WGM21);
+	TCCR2B = bit(CS21);
+	setISPQueueSpeed();
+} // end of startISPQueue
+
+// while the timer 2 interrupt gets on with the queue (yield does nothing on
+//  the board, a host build's clock runs in it)
+void queueWait()
+{
+	doBusyWork();
+	yield();
+} // end of queueWait
+
+// wait for everything queued to be sent
+void flushISPQueue()
+{
+	while (ispQueueTail != ispQueueHead)
+		queueWait();
+} // end of flushISPQueue
+
+void stopISPQueue()
+{
+	flushISPQueue();
+	TCCR2B = 0;
+} // end of stopISPQueue
+
+// queue one programming instruction, returns its sequence number for
+//  queuedAnswer (only good until ISP_QUEUE_SIZE more have been queued)
+byte queueInstruction(const byte b1, const byte b2, const byte b3, const byte b4)
+{
+	const byte seq = ispQueueHead;
+	ispInstructionType &instruction = ispQueue[seq % ISP_QUEUE_SIZE];
+
+	if (ispTransport != ISP_BITBANG || ispSpeed >= 0 || bbDelay < ISP_QUEUE_MIN_DELAY || GANG_TARGETS > 1)
+	{
+		flushISPQueue(); // after anything queued at a slower speed
+		instruction.b[0] = ispTransfer(b1);
+		instruction.b[1] = ispTransfer(b2);
+		instruction.b[2] = ispTransfer(b3);
+		instruction.b[3] = ispTransfer(b4);
+#if GANG_TARGETS > 1
+		memcpy(instruction.gang, gangIn, sizeof instruction.gang);
+#endif
+		ispQueueHead = ispQueueTail = seq + 1;
+		return seq;
+	} // end of sent straight away
+
+	// full? get on with something else meanwhile
+	while ((byte)(seq - ispQueueTail) >= ISP_QUEUE_SIZE)
+		queueWait();
+
+	instruction.b[0] = b1;
+	instruction.b[1] = b2;
+	instruction.b[2] = b3;
+	instruction.b[3] = b4;
+	ispQueueHead = seq + 1;
+	TIMSK2 |= bit(OCIE2A);
+	return seq;
+} // end of queueInstruction
+
+// what the target sent back on the 4th byte of a queued instruction
+byte queuedAnswer(const byte seq)
+{
+	while ((byte)(ispQueueTail - seq - 1) >= ISP_QUEUE_SIZE)
+		queueWait(); // not sent yet
+	return ispQueue[seq % ISP_QUEUE_SIZE].b[3];
+} // end of queuedAnswer
+
+// targets whose answer to a queued instruction was "expected", see answering
+byte queuedAnswering(const byte seq, const byte expected)
+{
+#if GANG_TARGETS > 1
+	queuedAnswer(seq);
+	return answeringFrom(ispQueue[seq % ISP_QUEUE_SIZE].gang, expected, 0xFF);
+#else
+	return queuedAnswer(seq) == expected;
+#endif
+} // end of queuedAnswering
+
+// each level up doubles the hardware clock, and moves along BB_DELAYS
+void setISPSpeed(const int8_t speed)
+{
+	ispSpeed = speed;
+
+	switch (ispTransport)
+	{
+#if ISP_TRANSPORT == ISP_MSPIM
+	case ISP_MSPIM:
+	{
+		unsigned long divider = ((MSPIM_UBRR + 1UL) << -ISP_SLOWEST) >> (speed - ISP_SLOWEST);
+		UBRR0 = divider > 0 ? divider - 1 : 0;
+	}
+	break;
+#endif
+
+#if ISP_TRANSPORT == ISP_HWSPI
+	case ISP_HWSPI:
+		HW_SPIRate(constrain(HW_SPIBaseRate - speed, 0, 6));
+		break;
+#endif
+
+	default:
+		bbDelay = BB_DELAYS[speed - ISP_SLOWEST];
+		setISPQueueSpeed();
+		break;
+	} // end of switch on transport
+} // end of setISPSpeed
 
 // if signature found in above table, this is its index
 int foundSig = -1;
@@ -376,16 +1017,19 @@ signatureType currentSignature;
 //  processor may return a result on the 4th transfer, this is returned.
 byte program(const byte b1, const byte b2 = 0, const byte b3 = 0, const byte b4 = 0) {
 
-	BB_SPITransfer(b1);
-	BB_SPITransfer(b2);
-	BB_SPITransfer(b3);
-	byte b = BB_SPITransfer(b4);
+	flushISPQueue(); // in order with anything queued
+
+	ispTransfer(b1);
+	ispTransfer(b2);
+	ispTransfer(b3);
+	byte b = ispTransfer(b4);
 	return b;
 
 } // end of program
 
-// read a byte from flash memory
-byte readFlash(unsigned long addr)
+// queue a read of a byte of flash memory, returns the sequence number to
+//  pass to queuedAnswer
+byte queueReadFlash(unsigned long addr)
 {
 	byte high = (addr & 1) ? 0x08 : 0; // set if high byte wanted
 	addr >>= 1;						   // turn into word address
@@ -394,66 +1038,155 @@ byte readFlash(unsigned long addr)
 	byte MSB = (addr >> 16) & 0xFF;
 	if (MSB != lastAddressMSB)
 	{
-		program(loadExtendedAddressByte, 0, MSB);
+		queueInstruction(loadExtendedAddressByte, 0, MSB, 0);
 		lastAddressMSB = MSB;
 	} // end if different MSB
 
-	return program(readProgramMemory | high, highByte(addr), lowByte(addr));
+	return queueInstruction(readProgramMemory | high, highByte(addr), lowByte(addr), 0);
+} // end of queueReadFlash
+
+// read a byte from flash memory
+byte readFlash(unsigned long addr)
+{
+	return queuedAnswer(queueReadFlash(addr));
 } // end of readFlash
 
-// write a byte to the flash memory buffer (ready for committing)
+// write a byte to the flash memory buffer (ready for committing), queued
 void writeFlash(unsigned long addr, const byte data)
 {
 	byte high = (addr & 1) ? 0x08 : 0; // set if high byte wanted
 	addr >>= 1;						   // turn into word address
-	program(loadProgramMemory | high, 0, lowByte(addr), data);
+	queueInstruction(loadProgramMemory | high, 0, lowByte(addr), data);
 } // end of writeFlash
 
-// convert two hex characters into a byte
-//    returns true if error, false if OK
-bool hexConv(const char *(&pStr), byte &b)
-{
-
-	if (!isxdigit(pStr[0]) || !isxdigit(pStr[1]))
-	{
-		ShowMessage(MSG_INVALID_HEX_DIGITS);
-		return true;
-	} // end not hex
-
-	b = *pStr++ - '0';
-	if (b > 9)
-		b -= 7;
-
-	// high-order nybble
-	b <<= 4;
+unsigned long pagesize;
+unsigned long pagemask;
+unsigned int progressBarCount;
 
-	byte b1 = *pStr++ - '0';
-	if (b1 > 9)
-		b1 -= 7;
+// kinds of target write pollUntilReady waits for
+enum
+{
+	busyFlash,
+	busyErase,
+	busyFuse,
+	busyKinds
+};
 
-	b |= b1;
+// how long the target stayed busy after one kind of write, uS
+typedef struct
+{
+	unsigned int count;
+	unsigned long total;
+	unsigned long shortest;
+	unsigned long longest;
+} busyStatsType;
 
-	return false; // OK
-} // end of hexConv
+// parts of a session, timed for the log (and the host benchmarks)
+enum
+{
+	phaseCheck,	  // file check, builds the page image
+	phaseCompare, // reading the target before erasing it
+	phaseErase,
+	phaseWrite,	 // with VERIFY_ON_WRITE this includes reading each page back
+	phaseVerify, // separate verify pass
+	phaseFuses,
+	phases // none of them
+};
 
-// poll the target device until it is ready to be programmed
-void pollUntilReady()
+// counters for the session summary in logFile
+typedef struct
 {
+	unsigned int pagesWritten;
+	unsigned int pagesSkipped; // blank pages, neither written nor verified
+	unsigned int pagesMatched; // pages the target already held before erasing
+	unsigned int pagesResumed; // pages a session cut short had written, see resumePages
+	unsigned int pagesRetried; // pages committed again after reading back wrong
+	unsigned int pagesFailed;  // pages still wrong after PAGE_WRITE_ATTEMPTS, or never committed
+	bool unchanged;			   // target matched the image, nothing was erased
+	bool checkSkipped;		   // the input file was checked in an earlier session
+	unsigned int timeouts;	   // writes the target never finished, see pollUntilReady
+	busyStatsType busy[busyKinds];
+	unsigned long phaseMicros[phases];
+} sessionStatsType;
+
+sessionStatsType stats;
+
+#if ISP_TRANSPORT == ISP_HOST
+// tools/host/host_main.cpp, snapshots its counters for each phase
+void hostPhase(byte which);
+#endif
+
+// phase running since phaseStart, see startPhase
+byte sessionPhase = phases;
+unsigned long phaseStart;
+
+// charge the time since the last call to the phase that was running, then
+//  start "which" (phases to stop timing)
+void startPhase(const byte which)
+{
+	const unsigned long now = micros();
+	if (sessionPhase < phases)
+		stats.phaseMicros[sessionPhase] += now - phaseStart;
+	sessionPhase = which;
+	phaseStart = now;
+
+#if ISP_TRANSPORT == ISP_HOST
+	hostPhase(which);
+#endif
+} // end of startPhase
+
+// wait for a write of the given kind to finish, polling RDY/BSY where the chip
+//  has it, otherwise waiting the datasheet figure in currentSignature
+// busyWork is done meanwhile, so the busy times include any step of it that
+//  runs past the end of the write
+// returns false if the target is still busy POLL_TIMEOUT_FACTOR times later
+bool pollUntilReady(const byte kind)
+{
+	const unsigned int us = kind == busyFlash	? currentSignature.tWDFlash
+							: kind == busyErase ? currentSignature.tWDErase
+												: currentSignature.tWDFuse;
+	const unsigned long timeout = (unsigned long)us * POLL_TIMEOUT_FACTOR;
+	const unsigned long start = micros();
+
 	if (currentSignature.timedWrites)
-		delay(10); // at least 2 x WD_FLASH which is 4.5 mS
+	{
+		while (busyWork != NULL && micros() - start < us)
+			doBusyWork();
+
+		const unsigned long spent = micros() - start;
+		if (spent < us)
+		{
+			delay((us - spent) / 1000);
+			delayMicroseconds((us - spent) % 1000);
+		}
+	}
 	else
 	{
-		while ((program(pollReady) & 1) == 1)
+		byte busy;
+		while ((busy = gangActive & ~answering(program(pollReady), 0, 1)) != 0)
 		{
-		} // wait till ready
-	}	  // end of if
+			doBusyWork();
+			if (micros() - start > timeout)
+			{
+				if (dropTargets(busy, gangNotReady))
+					break; // the rest of the gang finished
+				stats.timeouts++;
+				return false;
+			} // end of gave up
+		}	  // end of while busy
+	}		  // end of if
+
+	const unsigned long busy = micros() - start;
+	busyStatsType &b = stats.busy[kind];
+	if (b.count == 0 || busy < b.shortest)
+		b.shortest = busy;
+	if (busy > b.longest)
+		b.longest = busy;
+	b.total += busy;
+	b.count++;
+	return true;
 } // end of pollUntilReady
 
-unsigned long pagesize;
-unsigned long pagemask;
-unsigned long oldPage;
-unsigned int progressBarCount;
-
 // shows progress, toggles working LED
 void showProgress()
 {
@@ -468,8 +1201,8 @@ void clearPage()
 		writeFlash(i, 0xFF);
 } // end of clearPage
 
-// commit page to flash memory
-void commitPage(unsigned long addr)
+// commit page to flash memory, returns false if the target did not finish
+bool commitPage(unsigned long addr)
 {
 	addr >>= 1; // turn into word address
 
@@ -484,106 +1217,763 @@ void commitPage(unsigned long addr)
 	showProgress();
 
 	program(writeProgramMemory, highByte(addr), lowByte(addr));
-	pollUntilReady();
-
-	clearPage(); // clear ready for next page full
+	return pollUntilReady(busyFlash);
 } // end of commitPage
 
-// write data to temporary buffer, ready for committing
-void writeData(const unsigned long addr, const byte *pData, const int length)
+// the page being worked on, and the next one being read ahead (see nextPage)
+//  if there is room for it
+byte pageBuffers[READ_AHEAD ? 2 : 1][MAX_PAGE_SIZE];
+byte *pageBuffer = pageBuffers[0];
+byte *nextPageBuffer = pageBuffers[READ_AHEAD ? 1 : 0];
+unsigned long bufferedPage; // page in pageBuffer, or NO_PAGE
+
+// offsets in the target's temporary page that hold something other than 0xFF
+byte loadedMask[MAX_PAGE_SIZE / 8];
+
+// offsets in pageBuffer that were supplied by the file
+byte coveredMask[MAX_PAGE_SIZE / 8];
+
+// put data into pageBuffer, handing each completed page to flushPage
+void assembleData(unsigned long addr, const byte *pData, int length, void (*flushPage)())
+{
+	while (length > 0)
+	{
+		unsigned long thisPage = addr & pagemask;
+		// page changed? hand over old one
+		if (thisPage != bufferedPage)
+		{
+			if (bufferedPage != NO_PAGE)
+				flushPage();
+			bufferedPage = thisPage;
+			memset(pageBuffer, 0xFF, pagesize);
+			memset(coveredMask, 0, sizeof coveredMask);
+		} // end of page changed
+
+		// copy as much as fits in this page
+		unsigned int offset = addr - thisPage;
+		unsigned int count = min((unsigned long)length, pagesize - offset);
+		memcpy(&pageBuffer[offset], pData, count);
+		for (unsigned int i = offset; i < offset + count; i++)
+			coveredMask[i >> 3] |= bit(i & 7);
+		addr += count;
+		pData += count;
+		length -= count;
+	} // end of while
+} // end of assembleData
+
+// load pageBuffer into the target's temporary page in one burst
+//  the flash was erased, so 0xFF only needs loading where the temporary
+//  page may still hold something else from the page before
+void loadPage()
 {
-	// write each byte
-	for (int i = 0; i < length; i++)
-	{
-		unsigned long thisPage = (addr + i) & pagemask;
-		// page changed? commit old one
-		if (thisPage != oldPage && oldPage != NO_PAGE)
-			commitPage(oldPage);
-		// now this is the current page
-		oldPage = thisPage;
-		// put byte into work buffer
-		writeFlash(addr + i, pData[i]);
+	for (unsigned int i = 0; i < pagesize; i++)
+	{
+		byte data = pageBuffer[i];
+		byte mask = bit(i & 7);
+		if (data != 0xFF)
+			loadedMask[i >> 3] |= mask;
+		else if (loadedMask[i >> 3] & mask)
+			loadedMask[i >> 3] &= ~mask;
+		else
+			continue; // already 0xFF
+
+		queueInstruction(loadProgramMemory | ((i & 1) ? 0x08 : 0), 0, i >> 1, data);
 	} // end of for
+} // end of loadPage
 
-} // end of writeData
+// true if pageBuffer holds nothing but 0xFF, ie. what the erased flash has already
+bool blankPage()
+{
+	for (unsigned int i = 0; i < pagesize; i++)
+		if (pageBuffer[i] != 0xFF)
+			return false;
+	return true;
+} // end of blankPage
 
 // count errors
 unsigned int errors;
 
-void verifyData(const unsigned long addr, const byte *pData, const int length)
+// targets that read back wrong in the last pageDifferences
+byte wrongTargets;
+
+// number of bytes supplied by the file that the flash does not hold (on
+//  any target), the reads are queued up to ISP_READS_AHEAD ahead of the
+//  comparisons
+unsigned int pageDifferences(const unsigned long addr)
 {
-	// check each byte
-	for (int i = 0; i < length; i++)
+	byte reads[ISP_READS_AHEAD]; // sequence numbers, by offset % ISP_READS_AHEAD
+	unsigned int queued = 0;	 // offsets read so far
+	unsigned int count = 0;
+
+	wrongTargets = 0;
+	for (unsigned int i = 0; i < pagesize; i++)
 	{
-		unsigned long thisPage = (addr + i) & pagemask;
-		// page changed? show progress
-		if (thisPage != oldPage && oldPage != NO_PAGE)
-			showProgress();
-		// now this is the current page
-		oldPage = thisPage;
+		for (; queued < pagesize && queued < i + ISP_READS_AHEAD; queued++)
+			if (coveredMask[queued >> 3] & bit(queued & 7))
+				reads[queued % ISP_READS_AHEAD] = queueReadFlash(addr + queued);
 
-		byte found = readFlash(addr + i);
-		byte expected = pData[i];
-		if (found != expected)
-			errors++;
-	} // end of for
+		if ((coveredMask[i >> 3] & bit(i & 7)) == 0)
+			continue;
 
-} // end of verifyData
+		const byte right = queuedAnswering(reads[i % ISP_READS_AHEAD], pageBuffer[i]);
+		if (right != gangActive)
+		{
+			wrongTargets |= gangActive & ~right;
+			count++;
+		}
+	} // end of for each byte
+	return count;
+} // end of pageDifferences
 
-bool gotEndOfFile;
-unsigned long extendedAddress;
+// load and commit the page in pageBuffer, reading it back if VERIFY_ON_WRITE
+void writePage(const unsigned long addr)
+{
+	if (blankPage())
+	{
+		stats.pagesSkipped++;
+		return;
+	} // end of nothing to write
 
-unsigned long lowestAddress;
-unsigned long highestAddress;
-unsigned long bytesWritten;
-unsigned int lineCount;
+	// target stopped answering? don't spend a timeout on every page
+	if (stats.timeouts > 0)
+	{
+		stats.pagesFailed++;
+		return;
+	}
 
-/*
-  Line format:
+	for (byte attempt = 1;; attempt++)
+	{
+		loadPage(); // a retry loads every byte that is not 0xFF again
+		if (!commitPage(addr))
+		{
+			stats.pagesFailed++;
+			return;
+		}
 
-  :nnaaaatt(data)ss
+		if (!VERIFY_ON_WRITE || pageDifferences(addr) == 0)
+		{
+			stats.pagesWritten++;
+			return;
+		}
 
-  Where:
-  :      = a colon
+		if (attempt >= PAGE_WRITE_ATTEMPTS)
+		{
+			stats.pagesFailed++;
+			if (!dropTargets(wrongTargets, gangVerify))
+				errors++;
+			return;
+		} // end of out of attempts
 
-  (All of below in hex format)
+		stats.pagesRetried++;
+	} // end of for each attempt
+} // end of writePage
 
-  nn     = length of data part
-  aaaa   = address (eg. where to write data)
-  tt     = transaction type
-		   00 = data
-		   01 = end of file
-		   02 = extended segment address (changes high-order byte of the address)
-		   03 = start segment address *
-		   04 = linear address *
-		   05 = start linear address *
-  (data) = variable length data
-  ss     = sumcheck
+// flushPage callback for writeData
+void writeBufferedPage()
+{
+	writePage(bufferedPage);
+} // end of writeBufferedPage
 
-			  We don't use these
+// assemble data into pages, committing each one as it is completed
+void writeData(const unsigned long addr, const byte *pData, const int length)
+{
+	assembleData(addr, pData, length, writeBufferedPage);
+} // end of writeData
 
-*/
+unsigned long lowestAddress;
+unsigned long highestAddress;
+unsigned long bytesWritten;
 
-// returns true if error, false if OK
-bool processLine(const char *pLine, const byte action)
+SdFile imageOut;		 // page image being built by the check pass
+unsigned int imagePages; // pages written to it so far
+bool imageOk;			 // false once the page image can't be used
+bool imageReady;		 // true if a complete page image is on the card
+uint32_t imageMapCRC;	 // CRC-32 of its page map, identifies it in the journal
+
+// CRC of the page currently in pageBuffer
+unsigned int pageCRC()
 {
-	if (*pLine++ != ':')
+	unsigned int crc = 0xFFFF;
+	for (unsigned int i = 0; i < pagesize; i++)
+		crc = _crc_ccitt_update(crc, pageBuffer[i]);
+	return crc;
+} // end of pageCRC
+
+// add data to a CRC-32, start with 0xFFFFFFFF and invert the result
+uint32_t crc32Update(uint32_t crc, const void *pData, unsigned int length)
+{
+	const byte *p = (const byte *)pData;
+	while (length--)
 	{
-		ShowMessage(MSG_LINE_DOES_NOT_START_WITH_COLON);
-		return true; // error
-	}
+		crc = pgm_read_dword(&crc32Nibble[(crc ^ *p) & 0x0F]) ^ (crc >> 4);
+		crc = pgm_read_dword(&crc32Nibble[(crc ^ (*p++ >> 4)) & 0x0F]) ^ (crc >> 4);
+	} // end of while
+	return crc;
+} // end of crc32Update
 
-	const int maxHexData = 40;
-	byte hexBuffer[maxHexData];
-	int bytesInLine = 0;
+// create the page image file, with a placeholder header
+void startImage()
+{
+	imageHeaderType header = {};
 
-	if (action == checkFile)
-		if (lineCount++ % 40 == 0)
+	imageReady = false;
+	imagePages = 0;
+	imageMapCRC = 0xFFFFFFFF;
+
+	imageOk = pagesize <= MAX_PAGE_SIZE &&
+			  imageOut.open(imageFile, O_RDWR | O_CREAT | O_TRUNC) &&
+			  imageOut.write(&header, sizeof header) == (int)sizeof header;
+} // end of startImage
+
+// the check pass stopped on an error: close the image and take it off the card
+void dropImage()
+{
+	imageOut.close();
+	sd.remove(imageFile);
+	imageOk = false;
+} // end of dropImage
+
+// append the buffered page to the image file
+void flushImagePage()
+{
+	if (!imageOk || bufferedPage == NO_PAGE)
+		return;
+
+	imagePageType page = {bufferedPage, pageCRC()};
+	imageMapCRC = crc32Update(imageMapCRC, &page.addr, sizeof page.addr);
+	imageMapCRC = crc32Update(imageMapCRC, &page.crc, sizeof page.crc);
+
+	if (imageOut.write(&page, sizeof page) != (int)sizeof page ||
+		imageOut.write(pageBuffer, pagesize) != (int)pagesize)
+		imageOk = false;
+
+	imagePages++;
+} // end of flushImagePage
+
+// assemble data from the .hex file into pages for the image file
+void imageData(const unsigned long addr, const byte *pData, const int length)
+{
+	// going back to an earlier page would put it in the image twice
+	if (bufferedPage != NO_PAGE && (addr & pagemask) < bufferedPage)
+		imageOk = false;
+
+	if (imageOk)
+		assembleData(addr, pData, length, flushImagePage);
+} // end of imageData
+
+// write the final page and the real header, then close the image file
+void finishImage()
+{
+	flushImagePage();
+
+	imageHeaderType header = {IMAGE_MAGIC, pagesize, imagePages,
+							  lowestAddress, highestAddress, bytesWritten};
+
+	imageOk = imageOk && imageOut.seekSet(0) &&
+			  imageOut.write(&header, sizeof header) == (int)sizeof header;
+
+	imageReady = imageOut.close() && imageOk;
+	if (!imageReady)
+		sd.remove(imageFile); // fall back to parsing the .hex file
+} // end of finishImage
+
+// one session in the journal: which image to which chip, and where its
+//  progress records start in their ring
+typedef struct
+{
+	uint32_t mapCRC; // imageMapCRC
+	byte sig[3];
+	uint16_t ringStart;
+	byte seq; // one more than the session before, written last
+} journalHeaderType;
+
+// the first "chunks" * JOURNAL_PAGES pages of the image are written, or
+//  JOURNAL_DONE
+typedef struct
+{
+	byte chunks;
+	byte seq; // the session's, written last
+} journalRecordType;
+
+journalHeaderType journal;	 // this session's, see resumePages and startJournal
+unsigned int journalRecords; // progress records it has
+bool journalOn;				 // this session writes from the page image
+
+// EEPROM bytes waiting to be written, in order (a sequence number after
+//  what it marks as valid)
+typedef struct
+{
+	uint16_t addr;
+	byte value;
+} journalByteType;
+
+journalByteType journalQueue[JOURNAL_QUEUE];
+byte journalNext;	// next to write
+byte journalQueued; // waiting
+
+// write the next queued byte, if any
+void writeJournalByte()
+{
+	if (journalQueued == 0)
+		return;
+	const journalByteType &next = journalQueue[journalNext];
+	EEPROM.update(next.addr, next.value);
+	journalNext = (journalNext + 1) % JOURNAL_QUEUE;
+	journalQueued--;
+} // end of writeJournalByte
+
+// queue "length" bytes for EEPROM address "addr", waiting only if the
+//  queue is full
+void queueJournal(const int addr, const void *pData, const byte length)
+{
+	const byte *p = (const byte *)pData;
+	for (byte i = 0; i < length; i++)
+	{
+		if (journalQueued == JOURNAL_QUEUE)
+			writeJournalByte();
+		journalByteType &last = journalQueue[(journalNext + journalQueued) % JOURNAL_QUEUE];
+		last.addr = addr + i;
+		last.value = p[i];
+		journalQueued++;
+	} // end of for each byte
+} // end of queueJournal
+
+// EEPROM addresses of the two rings
+int journalHeaderAt(const byte slot)
+{
+	return slot * sizeof(journalHeaderType);
+} // end of journalHeaderAt
+
+int journalRecordAt(const unsigned int slot)
+{
+	return JOURNAL_HEADERS * sizeof(journalHeaderType) + (slot % JOURNAL_SLOTS) * sizeof(journalRecordType);
+} // end of journalRecordAt
+
+// the latest session in the header ring, where the run of sequence
+//  numbers breaks, returns its slot
+byte latestJournal(journalHeaderType &header)
+{
+	EEPROM.get(journalHeaderAt(0), header);
+	for (byte slot = 1; slot < JOURNAL_HEADERS; slot++)
+	{
+		journalHeaderType next;
+		EEPROM.get(journalHeaderAt(slot), next);
+		if (next.seq != (byte)(header.seq + 1))
+			return slot - 1;
+		header = next;
+	} // end of for each slot
+	return JOURNAL_HEADERS - 1;
+} // end of latestJournal
+
+// progress records a session wrote, "done" is set if the last one says it
+//  finished
+unsigned int countJournalRecords(const journalHeaderType &header, bool &done)
+{
+	unsigned int count = 0;
+	done = false;
+	while (count < JOURNAL_SLOTS && !done)
+	{
+		journalRecordType record;
+		EEPROM.get(journalRecordAt(header.ringStart + count), record);
+		if (record.seq != header.seq || (record.chunks != JOURNAL_DONE && record.chunks != count + 1))
+			break;
+		done = record.chunks == JOURNAL_DONE;
+		count++;
+	} // end of while records follow on
+	return count;
+} // end of countJournalRecords
+
+// next progress record of this session
+void addJournalRecord(const byte chunks)
+{
+	const journalRecordType record = {chunks, journal.seq};
+	queueJournal(journalRecordAt(journal.ringStart + journalRecords), &record, sizeof record);
+	journalRecords++;
+} // end of addJournalRecord
+
+// a new session, in the header slot after the latest, its records after
+//  the ones that session wrote
+void startJournal()
+{
+	journalHeaderType last;
+	bool done;
+	const byte slot = (latestJournal(last) + 1) % JOURNAL_HEADERS;
+
+	journal.mapCRC = imageMapCRC;
+	memcpy(journal.sig, currentSignature.sig, sizeof journal.sig);
+	journal.ringStart = (last.ringStart + countJournalRecords(last, done)) % JOURNAL_SLOTS;
+	journal.seq = last.seq + 1;
+	journalRecords = 0;
+	queueJournal(journalHeaderAt(slot), &journal, sizeof journal);
+} // end of startJournal
+
+// the first "pages" pages of the image are on the target
+void journalPages(const unsigned int pages)
+{
+	if (journalOn && pages % JOURNAL_PAGES == 0 && errors == 0 && stats.timeouts == 0)
+		addJournalRecord(pages / JOURNAL_PAGES);
+	writeJournalByte(); // the last has long finished, a page takes longer
+} // end of journalPages
+
+// the whole image is on the target, nothing to resume
+void finishJournal()
+{
+	if (journalOn)
+		addJournalRecord(JOURNAL_DONE);
+} // end of finishJournal
+
+// write whatever is still queued, before the next session
+void flushJournal()
+{
+	while (journalQueued > 0)
+		writeJournalByte();
+} // end of flushJournal
+
+// CRC of a page of the target's flash, as pageCRC, "blank" is set if it
+//  is all 0xFF
+unsigned int flashPageCRC(const unsigned long addr, bool &blank)
+{
+	byte reads[ISP_READS_AHEAD]; // sequence numbers, by offset % ISP_READS_AHEAD
+	unsigned int queued = 0;
+	unsigned int crc = 0xFFFF;
+
+	blank = true;
+	for (unsigned int i = 0; i < pagesize; i++)
+	{
+		for (; queued < pagesize && queued < i + ISP_READS_AHEAD; queued++)
+			reads[queued % ISP_READS_AHEAD] = queueReadFlash(addr + queued);
+
+		const byte data = queuedAnswer(reads[i % ISP_READS_AHEAD]);
+		crc = _crc_ccitt_update(crc, data);
+		if (data != 0xFF)
+			blank = false;
+	} // end of for each byte
+	return crc;
+} // end of flashPageCRC
+
+// pages at the start of the image that a session cut short left on the
+//  target, so the write can carry on after them without a chip erase
+// the latest journal entry has to be for this image and chip, and every
+//  page it records has to read back with the CRC in the page map; so may
+//  the pages up to the next record, the first that does not has to be
+//  blank (half written, only a chip erase would clear it)
+// returns 0 to start again from the erase
+unsigned int resumePages()
+{
+	journalQueued = 0; // left by a session that stopped on an error
+	if (!journalOn)
+		return 0;
+
+	bool done;
+	latestJournal(journal);
+	journalRecords = countJournalRecords(journal, done);
+	if (done || journalRecords == 0 || journal.mapCRC != imageMapCRC ||
+		memcmp(journal.sig, currentSignature.sig, sizeof journal.sig) != 0)
+		return 0;
+
+	SdFile image;
+	imageHeaderType header;
+	imagePageType page;
+	if (!image.open(imageFile, O_READ) || image.read(&header, sizeof header) != (int)sizeof header)
+	{
+		image.close();
+		return 0;
+	}
+
+	startPhase(phaseCompare);
+	const unsigned int recorded = journalRecords * JOURNAL_PAGES;
+	unsigned int pages = 0;
+	for (; pages < header.pageCount && pages < recorded + JOURNAL_PAGES; pages++)
+	{
+		// page map entry only, the page data is skipped
+		if (!image.seekSet(sizeof header + pages * (sizeof page + pagesize)) ||
+			image.read(&page, sizeof page) != (int)sizeof page)
+		{
+			pages = 0;
+			break;
+		}
+
+		if (pages < stats.pagesMatched)
+			continue; // read back whole by compare before write
+
+		bool blank;
+		if (flashPageCRC(page.addr, blank) == page.crc)
+			continue;
+
+		if (pages < recorded || !blank)
+			pages = 0;
+		break;
+	} // end of for each page to check
+	image.close();
+
+	// the records go up in ones, catch up with any pages found past the last
+	while (pages > 0 && journalRecords < pages / JOURNAL_PAGES)
+		addJournalRecord(journalRecords + 1);
+	return pages;
+} // end of resumePages
+
+// compare the page in pageBuffer with the flash, where the file supplied the data
+void verifyPage(const unsigned long addr)
+{
+	if (blankPage())
+		return; // never written, still erased
+
+	showProgress();
+
+	const unsigned int differences = pageDifferences(addr);
+	if (differences > 0 && !dropTargets(wrongTargets, gangVerify))
+		errors += differences;
+} // end of verifyPage
+
+// flushPage callback for verifyData
+void verifyBufferedPage()
+{
+	verifyPage(bufferedPage);
+} // end of verifyBufferedPage
+
+// assemble data into pages, verifying each one as it is completed
+void verifyData(const unsigned long addr, const byte *pData, const int length)
+{
+	assembleData(addr, pData, length, verifyBufferedPage);
+} // end of verifyData
+
+// compare the flash with the page in pageBuffer as a write would leave it,
+//  ie. 0xFF wherever the file has no data, stopping at the first difference
+void comparePage(const unsigned long addr)
+{
+	if (errors > 0)
+		return; // already know the target needs writing
+
+	showProgress();
+
+	for (unsigned int i = 0; i < pagesize; i++)
+		if (answering(readFlash(addr + i), pageBuffer[i]) != gangActive)
+		{
+			errors++;
+			return;
+		} // end of different (on any target)
+
+	stats.pagesMatched++;
+} // end of comparePage
+
+// flash below this is accounted for by the compare pass: the image pages
+//  and the blank ones between them, see compareBlank
+unsigned long comparedTo;
+
+// the flash from comparedTo up to "to" is not in the image, so a write
+//  would leave it erased: it has to read 0xFF for the target to match
+//  (a stale boot loader, or the end of a longer application, would not)
+void compareBlank(const unsigned long to)
+{
+	if (to < comparedTo)
+		errors++; // pages out of order, can't tell what lies between them
+
+	for (unsigned long addr = comparedTo; addr < to && errors == 0; addr++)
+	{
+		if ((addr & ~pagemask) == 0)
 			showProgress();
+		if (answering(readFlash(addr), 0xFF) != gangActive)
+			errors++;
+	} // end of for each byte
+	comparedTo = to;
+} // end of compareBlank
+
+// the compare pass reads every page of the flash, those outside the image
+//  to see that they are blank; reading a page takes about half as long as
+//  writing and verifying one, so it only pays while no more than half the
+//  flash is outside the image
+bool worthComparing(const unsigned int imagePages)
+{
+	return currentSignature.flashSize / pagesize <= 2UL * imagePages;
+} // end of worthComparing
+
+bool gotEndOfFile;
+unsigned long extendedAddress;
+unsigned int lineCount;
+
+/*
+  Line format:
+
+  :nnaaaatt(data)ss
+
+  Where:
+  :      = a colon
+
+  (All of below in hex format)
+
+  nn     = length of data part
+  aaaa   = address (eg. where to write data)
+  tt     = transaction type
+		   00 = data
+		   01 = end of file
+		   02 = extended segment address (changes high-order byte of the address)
+		   03 = start segment address *
+		   04 = linear address *
+		   05 = start linear address *
+  (data) = variable length data
+  ss     = sumcheck
+
+			  We don't use these
+
+*/
+
+// largest record we accept: length / address (2) / type / data / sumcheck
+const int maxHexData = 5 + 64;
+
+// the .hex file is read this many bytes at a time, a divisor of the 512 byte
+//  sector so that no read straddles two sectors in SdFat's cache
+const int HEX_CHUNK_SIZE = 64;
+
+// where decodeHexChar is within the current line
+enum
+{
+	hexLineStart,	 // expecting the colon
+	hexHighNibble,	 // expecting the first digit of a byte
+	hexLowNibble,	 // expecting the second digit of a byte
+	hexLineTrailer,	 // past the last digit, ignoring up to the end of the line
+};
+
+// record being decoded, carried over from one chunk of the file to the next
+byte hexBuffer[maxHexData];
+int bytesInLine;
+byte sumCheck;
+byte highNibble;
+byte hexState;
+
+// returns true if error, false if OK
+bool processRecord(const byte action)
+{
+	if (action == checkFile)
+		if (lineCount++ % 40 == 0)
+			showProgress();
+
+	if (bytesInLine < 5)
+	{
+		ShowMessage(MSG_LINE_TOO_SHORT);
+		return true;
+	}
+
+	// the sumcheck is the 2's complement of the other bytes, so they all add up to zero
+	if (sumCheck != 0)
+	{
+		ShowMessage(MSG_BAD_SUMCHECK);
+		return true;
+	}
+
+	// length of data (eg. how much to write to memory)
+	byte len = hexBuffer[0];
+
+	// the data length should be the number of bytes, less
+	//   length / address (2) / transaction type / sumcheck
+	if (len != (bytesInLine - 5))
+	{
+		ShowMessage(MSG_LINE_NOT_EXPECTED_LENGTH);
+		return true;
+	}
+
+	// two bytes of address
+	unsigned long addrH = hexBuffer[1];
+	unsigned long addrL = hexBuffer[2];
+
+	unsigned long addr = addrL | (addrH << 8);
+
+	byte recType = hexBuffer[3];
+
+	switch (recType)
+	{
+	// stuff to be written to memory
+	case hexDataRecord:
+		lowestAddress = min(lowestAddress, addr + extendedAddress);
+		highestAddress = max(lowestAddress, addr + extendedAddress + len - 1);
+		bytesWritten += len;
+
+		switch (action)
+		{
+		case checkFile: // we do the checks anyway, just build the page image
+			imageData(addr + extendedAddress, &hexBuffer[4], len);
+			break;
+
+		case verifyFlash:
+			verifyData(addr + extendedAddress, &hexBuffer[4], len);
+			break;
 
-	// convert entire line from ASCII into binary
-	while (isxdigit(*pLine))
+		case writeToFlash:
+			writeData(addr + extendedAddress, &hexBuffer[4], len);
+			break;
+
+		} // end of switch on action
+		break;
+
+	// end of data
+	case hexEndOfFile:
+		gotEndOfFile = true;
+		break;
+
+	// we are setting the high-order byte of the address
+	case hexExtendedSegmentAddressRecord:
+		extendedAddress = ((unsigned long)hexBuffer[4]) << 12;
+		break;
+
+	// ignore these, who cares?
+	case hexStartSegmentAddressRecord:
+	case hexExtendedLinearAddressRecord:
+	case hexStartLinearAddressRecord:
+		break;
+
+	default:
+		ShowMessage(MSG_UNKNOWN_RECORD_TYPE);
+		return true;
+	} // end of switch on recType
+
+	return false;
+} // end of processRecord
+
+// feed one character of the .hex file to the record decoder
+// returns true if error, false if OK
+bool decodeHexChar(const char c, const byte action)
+{
+	// end of line? then the record is complete (empty lines are ignored)
+	if (c == '\n' || c == '\r')
 	{
+		byte state = hexState;
+		hexState = hexLineStart;
+
+		switch (state)
+		{
+		case hexLineStart:
+			return false;
+
+		case hexLowNibble:
+			ShowMessage(MSG_INVALID_HEX_DIGITS);
+			return true;
+
+		default:
+			return processRecord(action);
+		} // end of switch on state
+	} // end of end of line
+
+	byte nibble = pgm_read_byte(&hexNibble[(byte)c]);
+
+	switch (hexState)
+	{
+	case hexLineStart:
+		if (c != ':')
+		{
+			ShowMessage(MSG_LINE_DOES_NOT_START_WITH_COLON);
+			return true; // error
+		}
+		bytesInLine = 0;
+		sumCheck = 0;
+		hexState = hexHighNibble;
+		break;
+
+	case hexHighNibble:
+		if (nibble == 0xFF)
+		{
+			hexState = hexLineTrailer; // rest of the line isn't ours
+			break;
+		}
+
 		// can't fit?
 		if (bytesInLine >= maxHexData)
 		{
@@ -591,106 +1981,525 @@ bool processLine(const char *pLine, const byte action)
 			return true;
 		} // end if too long
 
-		if (hexConv(pLine, hexBuffer[bytesInLine++]))
+		highNibble = nibble;
+		hexState = hexLowNibble;
+		break;
+
+	case hexLowNibble:
+		if (nibble == 0xFF)
+		{
+			ShowMessage(MSG_INVALID_HEX_DIGITS);
 			return true;
-	} // end of while
+		} // end not hex
+
+		// convert from ASCII into binary, summing as we go
+		hexBuffer[bytesInLine] = (highNibble << 4) | nibble;
+		sumCheck += hexBuffer[bytesInLine++];
+		hexState = hexHighNibble;
+		break;
+	} // end of switch on state
+
+	return false;
+} // end of decodeHexChar
+
+// feed "count" characters of the .hex file to the record decoder: the data
+//  digits of a record are decoded two bytes (four digits) per iteration,
+//  anything else (colon, line ending, odd digit, a record too long) goes
+//  through decodeHexChar
+// returns true if error, false if OK
+bool decodeHexChunk(const byte *chunk, const int count, const byte action)
+{
+	int i = 0;
+	while (i < count)
+	{
+		if (hexState == hexHighNibble)
+		{
+			// room for every byte still in the chunk? then no need to check each one
+			const int room = maxHexData - bytesInLine;
+			const int end = count - i < room * 2 ? count : i + room * 2;
+			byte *out = &hexBuffer[bytesInLine];
+			byte sum = sumCheck;
+
+			while (i + 4 <= end)
+			{
+				const byte n0 = pgm_read_byte(&hexNibble[chunk[i]]);
+				const byte n1 = pgm_read_byte(&hexNibble[chunk[i + 1]]);
+				const byte n2 = pgm_read_byte(&hexNibble[chunk[i + 2]]);
+				const byte n3 = pgm_read_byte(&hexNibble[chunk[i + 3]]);
+				if ((n0 | n1 | n2 | n3) & 0xF0)
+					break; // not four digits, 0xFF marks anything else
+				out[0] = (n0 << 4) | n1;
+				out[1] = (n2 << 4) | n3;
+				sum += out[0] + out[1];
+				out += 2;
+				i += 4;
+			} // end of while two bytes
+
+			if (i + 2 <= end)
+			{
+				const byte n0 = pgm_read_byte(&hexNibble[chunk[i]]);
+				const byte n1 = pgm_read_byte(&hexNibble[chunk[i + 1]]);
+				if (((n0 | n1) & 0xF0) == 0)
+				{
+					*out = (n0 << 4) | n1;
+					sum += *out++;
+					i += 2;
+				}
+			} // end of one byte left
+
+			bytesInLine = out - hexBuffer;
+			sumCheck = sum;
+			if (i >= count)
+				break;
+		} // end of data digits
+
+		if (decodeHexChar(chunk[i++], action))
+			return true;
+	} // end of while each character
+
+	return false;
+} // end of decodeHexChunk
+
+// read wantedFile a chunk at a time, decoding records straight out of
+//  each chunk (a record may carry on into the next one)
+// returns true if error, false if OK
+bool parseHexFile(const byte action)
+{
+	SdFile hex;
+	byte chunk[HEX_CHUNK_SIZE];
+	int count;
+
+	// check for open error
+	if (!hex.open(wantedFile, O_READ))
+	{
+		ShowMessage(MSG_CANNOT_OPEN_FILE);
+		return true;
+	}
+
+	// build the page image as we go, now that there is a file to build it from
+	if (action == checkFile)
+		startImage();
+
+	hexState = hexLineStart;
+
+	while ((count = hex.read(chunk, sizeof chunk)) > 0)
+		if (decodeHexChunk(chunk, count, action))
+		{
+			hex.close();
+			return true; // error
+		}
+
+	hex.close();
+
+	// read error
+	if (count < 0)
+	{
+		ShowMessage(MSG_CANNOT_OPEN_FILE);
+		return true;
+	}
+
+	// finish off a last line without a line ending
+	if (decodeHexChar('\n', action))
+		return true;
+
+	if (!gotEndOfFile)
+	{
+		ShowMessage(MSG_NO_END_OF_FILE_RECORD);
+		return true;
+	}
+
+	return false;
+} // end of parseHexFile
+
+// the page image and .pfw files are read one page ahead: nextPage hands
+//  over a page and starts on the next, and whatever of that is left to read
+//  while the target is busy writing the page is read then, a chunk between
+//  polls, so reading the card and writing the flash overlap (with READ_AHEAD
+//  0 there is one page buffer, and nextPage reads each page whole)
+SdFile *aheadFile; // being read ahead, NULL for none
+union
+{
+	imagePageType image;
+	pfwPageType pfw;
+} aheadEntry;				 // page map entry of the next page
+byte aheadEntrySize;		 // sizeof the map entry type
+unsigned int aheadPagesLeft; // including the one being read
+unsigned int aheadDone;		 // bytes of the next map entry and page read
+bool aheadFailed;			 // read error
+
+// read up to "limit" more bytes of the next page
+// returns true once it is all there (or the read failed)
+bool readAhead(unsigned int limit)
+{
+	const unsigned int total = aheadEntrySize + pagesize;
+	while (aheadDone < total && limit > 0 && !aheadFailed)
+	{
+		byte *into = aheadDone < aheadEntrySize ? (byte *)&aheadEntry + aheadDone
+												: &nextPageBuffer[aheadDone - aheadEntrySize];
+		unsigned int count = min(limit, (aheadDone < aheadEntrySize ? aheadEntrySize : total) - aheadDone);
+		if (aheadFile->read(into, count) != (int)count)
+			aheadFailed = true;
+		aheadDone += count;
+		limit -= count;
+	} // end of while more to read
+	return aheadDone >= total || aheadFailed;
+} // end of readAhead
+
+// busyWork while reading ahead
+bool readAheadChunk()
+{
+	return readAhead(READ_AHEAD_CHUNK);
+} // end of readAheadChunk
+
+// read "pages" pages, each after a map entry of "entrySize" bytes, from file
+void startReadAhead(SdFile &file, const unsigned int pages, const byte entrySize)
+{
+	aheadFile = &file;
+	aheadPagesLeft = pages;
+	aheadEntrySize = entrySize;
+	aheadDone = 0;
+	aheadFailed = false;
+} // end of startReadAhead
+
+// before the file is closed
+void stopReadAhead()
+{
+	busyWork = NULL;
+	aheadFile = NULL;
+} // end of stopReadAhead
+
+// finish reading the next page, leave its map entry in "entry" and the page
+//  in pageBuffer, and start on the one after
+// returns true if error, false if OK
+bool nextPage(void *entry)
+{
+	busyWork = NULL;
+	if (aheadPagesLeft == 0)
+		return true;
+	readAhead(aheadEntrySize + pagesize);
+	if (aheadFailed)
+		return true;
+
+	memcpy(entry, &aheadEntry, aheadEntrySize);
+	byte *page = pageBuffer;
+	pageBuffer = nextPageBuffer;
+	nextPageBuffer = page;
+
+	aheadDone = 0;
+	if (--aheadPagesLeft > 0 && READ_AHEAD) // else the next read would land in the page being written
+		busyWork = readAheadChunk;
+	return false;
+} // end of nextPage
+
+// stream the page image built by the check pass, no parsing needed
+// returns true if error, false if OK
+bool readImage(const byte action)
+{
+	SdFile image;
+	imageHeaderType header;
+	imagePageType page;
+
+	if (!image.open(imageFile, O_READ) ||
+		image.read(&header, sizeof header) != (int)sizeof header ||
+		header.magic != IMAGE_MAGIC || header.pageSize != pagesize)
+	{
+		image.close();
+		ShowMessage(MSG_CANNOT_OPEN_FILE);
+		return true;
+	}
+
+	// no lines get processed, so take these from the check pass
+	lowestAddress = header.lowestAddress;
+	highestAddress = header.highestAddress;
+	bytesWritten = header.bytesWritten;
+
+	// pages a session cut short already wrote, see resumePages
+	const unsigned int first = action == writeToFlash ? stats.pagesResumed : 0;
+	if (first > 0 && !image.seekSet(sizeof header + first * (sizeof page + pagesize)))
+	{
+		image.close();
+		ShowMessage(MSG_CANNOT_OPEN_FILE);
+		return true;
+	}
+
+	if (action == compareFlash && !worthComparing(header.pageCount))
+	{
+		image.close();
+		errors++; // write it instead
+		return false;
+	}
+
+	startReadAhead(image, header.pageCount - first, sizeof page);
+	for (unsigned int i = first; i < header.pageCount; i++)
+	{
+		// page map entry, then the page itself
+		if (nextPage(&page) || pageCRC() != page.crc)
+		{
+			stopReadAhead();
+			image.close();
+			ShowMessage(MSG_BAD_SUMCHECK);
+			return true;
+		}
+
+		switch (action)
+		{
+		case verifyFlash:
+			memset(coveredMask, 0xFF, sizeof coveredMask); // whole page
+			verifyPage(page.addr);
+			break;
+
+		case writeToFlash:
+			memset(coveredMask, 0xFF, sizeof coveredMask); // whole page
+			writePage(page.addr);
+			journalPages(i + 1);
+			break;
+
+		case compareFlash:
+			compareBlank(page.addr);
+			comparePage(page.addr);
+			comparedTo = page.addr + pagesize;
+			break;
+		} // end of switch on action
+
+		if ((action == compareFlash && errors > 0) || stats.timeouts > 0)
+			break; // no need to read the rest
+	}	  // end of for each page
+
+	stopReadAhead();
+	image.close();
+	return false;
+} // end of readImage
+
+pfwHeaderType pfwHeader; // of the .pfw file on the card
+bool pfwReady;			  // true if it is used instead of the .hex file
+
+// true if there is a .pfw file on the card, leaves its header in pfwHeader
+bool findPfw()
+{
+	SdFile pfw;
+
+	bool found = pfw.open(pfwFile, O_READ) &&
+				 pfw.read(&pfwHeader, sizeof pfwHeader) == (int)sizeof pfwHeader &&
+				 (pfwHeader.magic == PFW_MAGIC || pfwHeader.magic == PFWZ_MAGIC);
+
+	pfw.close();
+	return found;
+} // end of findPfw
+
+// compressed page being read, see unpackPage
+byte pfwChunk[PFW_CHUNK_SIZE];
+byte pfwChunkCount;
+byte pfwChunkUsed;
+unsigned long pfwPackedLeft; // compressed bytes of the page not read yet
+uint32_t *pfwCRC;			 // CRC to add what is read to, or NULL
+
+// next byte of the compressed page, or -1 if there are no more
+int nextPackedByte(SdFile &pfw)
+{
+	if (pfwChunkUsed >= pfwChunkCount)
+	{
+		if (pfwPackedLeft == 0)
+			return -1;
+
+		int count = pfw.read(pfwChunk, min(pfwPackedLeft, (unsigned long)sizeof pfwChunk));
+		if (count <= 0)
+			return -1;
+
+		if (pfwCRC)
+			*pfwCRC = crc32Update(*pfwCRC, pfwChunk, count);
+
+		pfwPackedLeft -= count;
+		pfwChunkCount = count;
+		pfwChunkUsed = 0;
+	} // end of chunk used up
+
+	return pfwChunk[pfwChunkUsed++];
+} // end of nextPackedByte
+
+// decompress the next "length" bytes of the .pfw file into pageBuffer
+//  each token is one of:
+//    0nnnnnnn             n + 1 literal bytes follow
+//    1nnnnnnn oooooooo    copy n + 3 bytes from o + 1 bytes back in the page
+//  so the page decompressed so far is the only window needed
+// returns true if error, false if OK
+bool unpackPage(SdFile &pfw, const unsigned long length, uint32_t *pCRC)
+{
+	pfwChunkCount = pfwChunkUsed = 0;
+	pfwPackedLeft = length;
+	pfwCRC = pCRC;
+
+	unsigned int out = 0;
+	int token;
+
+	while ((token = nextPackedByte(pfw)) >= 0)
+	{
+		unsigned int count;
+
+		if (token & 0x80)
+		{
+			count = (token & 0x7F) + 3;
+			int back = nextPackedByte(pfw);
+			if (back < 0 || (unsigned int)back >= out || out + count > pagesize)
+				return true;
+
+			// byte by byte, the copy may overlap what it is making
+			const byte *from = &pageBuffer[out - back - 1];
+			while (count--)
+				pageBuffer[out++] = *from++;
+		}
+		else
+		{
+			count = token + 1;
+			if (out + count > pagesize)
+				return true;
+
+			while (count--)
+			{
+				int b = nextPackedByte(pfw);
+				if (b < 0)
+					return true;
+				pageBuffer[out++] = b;
+			} // end of for each literal
+		}	  // end of literals
+	}		  // end of while each token
+
+	// short page, or a read error part way through
+	return out != pagesize || pfwPackedLeft != 0;
+} // end of unpackPage
+
+// read the next page map entry and page of the .pfw file into page and
+//  pageBuffer, adding what was read to *pCRC if it isn't NULL
+// returns true if error, false if OK
+bool readPfwPage(SdFile &pfw, const bool packed, pfwPageType &page, uint32_t *pCRC)
+{
+	if (packed)
+	{
+		pfwPackedPageType packedPage;
+		if (pfw.read(&packedPage, sizeof packedPage) != (int)sizeof packedPage)
+			return true;
+		if (pCRC)
+			*pCRC = crc32Update(*pCRC, &packedPage, sizeof packedPage);
+
+		page.addr = packedPage.addr;
+		page.crc = packedPage.crc;
+		return unpackPage(pfw, packedPage.length, pCRC);
+	} // end of compressed
+
+	if (pfw.read(&page, sizeof page) != (int)sizeof page ||
+		pfw.read(pageBuffer, pagesize) != (int)pagesize)
+		return true;
 
-	if (bytesInLine < 5)
+	if (pCRC)
 	{
-		ShowMessage(MSG_LINE_TOO_SHORT);
-		return true;
+		*pCRC = crc32Update(*pCRC, &page, sizeof page);
+		*pCRC = crc32Update(*pCRC, pageBuffer, pagesize);
 	}
+	return false;
+} // end of readPfwPage
 
-	// sumcheck it
-
-	byte sumCheck = 0;
-	for (int i = 0; i < (bytesInLine - 1); i++)
-		sumCheck += hexBuffer[i];
-
-	// 2's complement
-	sumCheck = ~sumCheck + 1;
+// stream the .pfw file, checking each page CRC (and in the check pass the
+//  CRC of the whole file)
+// returns true if error, false if OK
+bool readPfw(const byte action)
+{
+	SdFile pfw;
+	pfwHeaderType header;
+	pfwPageType page;
 
-	// check sumcheck
-	if (sumCheck != hexBuffer[bytesInLine - 1])
+	if (!pfw.open(pfwFile, O_READ) ||
+		pfw.read(&header, sizeof header) != (int)sizeof header ||
+		(header.magic != PFW_MAGIC && header.magic != PFWZ_MAGIC))
 	{
-		ShowMessage(MSG_BAD_SUMCHECK);
+		pfw.close();
+		ShowMessage(MSG_CANNOT_OPEN_FILE);
 		return true;
 	}
 
-	// length of data (eg. how much to write to memory)
-	byte len = hexBuffer[0];
-
-	// the data length should be the number of bytes, less
-	//   length / address (2) / transaction type / sumcheck
-	if (len != (bytesInLine - 5))
+	// made for another chip?
+	if (memcmp(header.sig, currentSignature.sig, sizeof header.sig) != 0 ||
+		header.pageSize != pagesize || header.flashSize != currentSignature.flashSize)
 	{
-		ShowMessage(MSG_LINE_NOT_EXPECTED_LENGTH);
+		pfw.close();
+		ShowMessage(MSG_UNRECOGNIZED_SIGNATURE);
 		return true;
 	}
 
-	// two bytes of address
-	unsigned long addrH = hexBuffer[1];
-	unsigned long addrL = hexBuffer[2];
+	// no lines get processed, so take these from the header
+	lowestAddress = header.lowestAddress;
+	highestAddress = header.highestAddress;
+	bytesWritten = header.bytesWritten;
 
-	unsigned long addr = addrL | (addrH << 8);
+	if (action == compareFlash && !worthComparing(header.pageCount))
+	{
+		pfw.close();
+		errors++; // write it instead
+		return false;
+	}
 
-	byte recType = hexBuffer[3];
+	uint32_t imageCRC = 0xFFFFFFFF;
 
-	switch (recType)
+	// uncompressed pages are read ahead while writing, the rest in turn
+	const bool ahead = action == writeToFlash && header.magic == PFW_MAGIC;
+	if (ahead)
+		startReadAhead(pfw, header.pageCount, sizeof page);
+
+	for (unsigned int i = 0; i < header.pageCount; i++)
 	{
-	// stuff to be written to memory
-	case hexDataRecord:
-		lowestAddress = min(lowestAddress, addr + extendedAddress);
-		highestAddress = max(lowestAddress, addr + extendedAddress + len - 1);
-		bytesWritten += len;
+		// page map entry, then the page itself
+		if ((ahead ? nextPage(&page)
+				   : readPfwPage(pfw, header.magic == PFWZ_MAGIC, page, action == checkFile ? &imageCRC : NULL)) ||
+			(uint32_t)~crc32Update(0xFFFFFFFF, pageBuffer, pagesize) != page.crc)
+		{
+			stopReadAhead();
+			pfw.close();
+			ShowMessage(MSG_BAD_SUMCHECK);
+			return true;
+		}
 
 		switch (action)
 		{
-		case checkFile: // nothing much to do, we do the checks anyway
+		case checkFile:
+			if (i % 8 == 0)
+				showProgress();
 			break;
 
 		case verifyFlash:
-			verifyData(addr + extendedAddress, &hexBuffer[4], len);
+			memset(coveredMask, 0xFF, sizeof coveredMask); // whole page
+			verifyPage(page.addr);
 			break;
 
 		case writeToFlash:
-			writeData(addr + extendedAddress, &hexBuffer[4], len);
+			memset(coveredMask, 0xFF, sizeof coveredMask); // whole page
+			writePage(page.addr);
 			break;
-		} // end of switch on action
-		break;
 
-	// end of data
-	case hexEndOfFile:
-		gotEndOfFile = true;
-		break;
+		case compareFlash:
+			compareBlank(page.addr);
+			comparePage(page.addr);
+			comparedTo = page.addr + pagesize;
+			break;
+		} // end of switch on action
 
-	// we are setting the high-order byte of the address
-	case hexExtendedSegmentAddressRecord:
-		extendedAddress = ((unsigned long)hexBuffer[4]) << 12;
-		break;
+		if ((action == compareFlash && errors > 0) || stats.timeouts > 0)
+			break; // no need to read the rest
+	}	  // end of for each page
 
-	// ignore these, who cares?
-	case hexStartSegmentAddressRecord:
-	case hexExtendedLinearAddressRecord:
-	case hexStartLinearAddressRecord:
-		break;
+	stopReadAhead();
+	pfw.close();
 
-	default:
-		ShowMessage(MSG_UNKNOWN_RECORD_TYPE);
+	if (action == checkFile && (uint32_t)~imageCRC != header.imageCRC)
+	{
+		ShowMessage(MSG_BAD_SUMCHECK);
 		return true;
-	} // end of switch on recType
+	}
 
 	return false;
-} // end of processLine
+} // end of readPfw
 
 //------------------------------------------------------------------------------
 // returns true if error, false if OK
-bool readHexFile(const char *fName, const byte action)
+bool readHexFile(const byte action)
 {
-
-	const int maxLine = 80;
-	char buffer[maxLine];
-	int lineNumber = 0;
 	gotEndOfFile = false;
 	extendedAddress = 0;
 	errors = 0;
@@ -701,58 +2510,68 @@ bool readHexFile(const char *fName, const byte action)
 
 	pagesize = currentSignature.pageSize;
 	pagemask = ~(pagesize - 1);
-	oldPage = NO_PAGE;
+	bufferedPage = NO_PAGE;
 
 
 	PORTB |= 0b00000001;
-	ifstream sdin("fw.hex");
-
-	// check for open error
-	if (!sdin.is_open())
-	{
-		ShowMessage(MSG_CANNOT_OPEN_FILE);
-		return true;
-	}
 
 	switch (action)
 	{
 	case checkFile:
+	case verifyFlash:
 		break;
 
-	case verifyFlash:
+	case compareFlash:
+		// the flash between the image's pages is checked as they go by,
+		//  which needs them in address order: the page image and the .pfw
+		//  file have them so, a .hex file need not
+		comparedTo = 0;
+		if (!pfwReady && !imageReady)
+		{
+			errors++; // can't tell, write it
+			return false;
+		}
 		break;
 
 	case writeToFlash:
-		program(progamEnable, chipErase); // erase it
-		delay(20);						  // for Atmega8
-		pollUntilReady();
-		clearPage(); // clear temporary page
+		// carry on after a session cut short, or start from the erase
+		//  (single target, page image only)
+		journalOn = GANG_TARGETS == 1 && imageReady && !pfwReady;
+		stats.pagesResumed = resumePages();
+		if (stats.pagesResumed == 0)
+		{
+			startPhase(phaseErase);
+			program(progamEnable, chipErase); // erase it
+			if (!pollUntilReady(busyErase))
+			{
+				ShowMessage(MSG_TARGET_NOT_READY);
+				return true;
+			} // end of erase never finished
+			if (journalOn)
+				startJournal();
+		} // end of erase
+		startPhase(phaseWrite);
+		clearPage(); // clear temporary page, loadPage keeps track from here
+		memset(loadedMask, 0, sizeof loadedMask);
 		break;
 	} // end of switch
 
-	while (sdin.getline(buffer, maxLine))
+	// the check pass left a page image behind? then it is the only pass
+	//  that has to parse the .hex file
+	if (pfwReady)
 	{
-		lineNumber++;
-		int count = sdin.gcount();
-		if (sdin.fail())
-		{
-			ShowMessage(MSG_LINE_TOO_LONG);
+		if (readPfw(action))
 			return true;
-		} // end of fail (line too long?)
-
-		// ignore empty lines
-		if (count > 1)
-		{
-			if (processLine(buffer, action))
-			{
-				return true; // error
-			}
-		}
-	} // end of while each line
-
-	if (!gotEndOfFile)
+	}
+	else if (action != checkFile && imageReady)
 	{
-		ShowMessage(MSG_NO_END_OF_FILE_RECORD);
+		if (readImage(action))
+			return true;
+	}
+	else if (parseHexFile(action))
+	{
+		if (action == checkFile)
+			dropImage(); // don't leave part of an image behind
 		return true;
 	}
 
@@ -760,11 +2579,29 @@ bool readHexFile(const char *fName, const byte action)
 	{
 	case writeToFlash:
 		// commit final page
-		if (oldPage != NO_PAGE)
-			commitPage(oldPage);
+		if (bufferedPage != NO_PAGE)
+			writePage(bufferedPage);
+
+		if (stats.timeouts > 0)
+		{
+			ShowMessage(MSG_TARGET_NOT_READY);
+			return true;
+		} // end if
+
+		if (errors > 0)
+		{
+			ShowMessage(MSG_VERIFICATION_ERROR);
+			return true;
+		} // end if
+
+		finishJournal();
 		break;
 
 	case verifyFlash:
+		// check final page
+		if (bufferedPage != NO_PAGE)
+			verifyPage(bufferedPage);
+
 		if (errors > 0)
 		{
 			ShowMessage(MSG_VERIFICATION_ERROR);
@@ -772,71 +2609,229 @@ bool readHexFile(const char *fName, const byte action)
 		} // end if
 		break;
 
+	case compareFlash:
+		// and on up to the end of the flash, errors tells the caller whether
+		//  the target differs
+		compareBlank(currentSignature.flashSize);
+		break;
+
 	case checkFile:
+		if (!pfwReady)
+			finishImage();
 		break;
 	} // end of switch
 
 	return false;
 } // end of readHexFile
 
-// returns true if managed to enter programming mode
-bool startProgramming()
+// take over the pins for one of the ISP transports
+void startTransport(const byte which)
 {
+	switch (which)
+	{
+#if ISP_TRANSPORT == ISP_MSPIM
+	case ISP_MSPIM:
+		MSPIM_start();
+		ispTransfer = MSPIM_SPITransfer;
+		break;
+#endif
 
-	// ON Burn Buffer
-	PORTB |= 0b00000001;
+#if ISP_TRANSPORT == ISP_HWSPI
+	case ISP_HWSPI:
+		HW_SPIStart();
+		ispTransfer = HW_SPITransfer;
+		break;
+#endif
+
+#if ISP_TRANSPORT == ISP_HOST
+	case ISP_HOST:
+#if GANG_TARGETS > 1
+		ispTransfer = hostGangSPITransfer;
+#else
+		ispTransfer = hostSPITransfer; // speed and stop as bit banged
+#endif
+		break;
+#endif
+
+	default:
+		BB_ISP::Start();
+		startISPQueue();
+		ispTransfer = BB_SPITransfer;
+		break;
+	} // end of switch on which transport
 
-	byte confirm;
-	pinMode(RESET, OUTPUT);
-	digitalWrite(MSPIM_SCK, LOW);
-	pinMode(MSPIM_SCK, OUTPUT);
-	pinMode(BB_MOSI, OUTPUT);
+	ispTransport = which;
+} // end of startTransport
+
+// release the pins used by the current transport
+void stopTransport()
+{
+	switch (ispTransport)
+	{
+#if ISP_TRANSPORT == ISP_MSPIM
+	case ISP_MSPIM:
+		MSPIM_stop();
+		break;
+#endif
+
+#if ISP_TRANSPORT == ISP_HWSPI
+	case ISP_HWSPI:
+		break; // bus belongs to the SD card
+#endif
+
+	default:
+		stopISPQueue();
+		BB_ISP::Stop(); // back to inputs, pull-ups off
+		break;
+	} // end of switch on transport
+} // end of stopTransport
+
+// returns true if the target answered within "attempts" tries (a gang
+//  carries on with those that answered the last try)
+bool syncTarget(const unsigned int attempts)
+{
+	byte answered;
 	unsigned int timeout = 0;
 
 	// we are in sync if we get back programAcknowledge on the third byte
 	do {
-		// regrouping pause
-		delay(100);
-
-		// ensure SCK low
-		digitalWrite(MSPIM_SCK, LOW);
+		// ensure SCK low (the hardware transports idle low anyway)
+		if (ispTransport == ISP_BITBANG)
+			BB_ISP::SCK::Low();
 
 		// then pulse reset, see page 309 of datasheet
-		digitalWrite(RESET, HIGH);
-		delayMicroseconds(10); // pulse for at least 2 clock cycles
-		digitalWrite(RESET, LOW);
+		BB_ISP::Pulse_Reset();
+
+		// wait at least 20 mS, or what the datasheet asks once we know the chip
+		delay(foundSig == -1 ? RESET_SETTLE_MS : currentSignature.tReset);
+		ispTransfer(progamEnable);
+		ispTransfer(programAcknowledge);
+		answered = answering(ispTransfer(0), programAcknowledge);
+		ispTransfer(0);
 
-		delay(25); // wait at least 20 mS
-		BB_SPITransfer(progamEnable);
-		BB_SPITransfer(programAcknowledge);
-		confirm = BB_SPITransfer(0);
-		BB_SPITransfer(0);
+		if (answered != gangActive) {
 
-		if (confirm != programAcknowledge) {
+			if (timeout++ >= attempts)
+				return answered != 0 && dropTargets(gangActive & ~answered, gangNoTarget);
 
-			if (timeout++ >= ENTER_PROGRAMMING_ATTEMPTS) return false;
+			// regrouping pause
+			delay(RESYNC_PAUSE_MS);
 
 		} // end of not entered programming mode
 
-	} while (confirm != programAcknowledge);
+	} while (answered != gangActive);
+
+	return true;
+} // end of syncTarget
+
+// sync at level 0, or the first slower level the target answers to
+bool findSpeed(const unsigned int attempts)
+{
+	for (int8_t speed = 0; speed >= ISP_SLOWEST; speed--)
+	{
+		setISPSpeed(speed);
+		if (syncTarget(speed == 0 ? attempts : SLOW_PROGRAMMING_ATTEMPTS))
+			return true;
+	} // end of for each slower speed
+	return false;
+} // end of findSpeed
+
+// true if the target gives the same signature twice at the current speed,
+//  echoing each instruction as it goes
+// only signature reads are sent at a speed that may be too fast: a target
+//  that samples them wrongly is far less likely to take one for programming
+//  enable or a write than if those went out at that speed
+bool probeTarget(const byte *sig)
+{
+	flushISPQueue(); // in order with anything queued
+
+	for (byte pass = 0; pass < 2; pass++)
+		for (byte i = 0; i < 3; i++)
+		{
+			ispTransfer(readSignatureByte);
+			byte inStep = answering(ispTransfer(0), readSignatureByte);
+			ispTransfer(i);
+			inStep &= answering(ispTransfer(0), sig[i]);
+			if (inStep != gangActive)
+				return false;
+		} // end for each signature byte
+
+	return true;
+} // end of probeTarget
+
+// probe faster speeds, lock in one step below the fastest that worked
+// returns true if still in programming mode
+bool negotiateSpeed()
+{
+	const int8_t safe = ispSpeed;
+	byte sig[3];
+	for (byte i = 0; i < 3; i++)
+		sig[i] = program(readSignatureByte, 0, i);
+
+	int8_t fastest = safe;
+	while (fastest < ISP_FASTEST)
+	{
+		setISPSpeed(fastest + 1);
+		if (!probeTarget(sig))
+			break;
+		fastest++;
+	} // end of while faster speeds work
+
+	setISPSpeed(fastest > safe ? fastest - 1 : safe);
+	ispSpeedLocked = true;
+
+	if (fastest == ISP_FASTEST)
+		return true; // no probe failed, still in step
+
+	// a failed probe can leave the target out of step, start again
+	if (syncTarget(ENTER_PROGRAMMING_ATTEMPTS))
+		return true;
+	setISPSpeed(safe);
+	return syncTarget(ENTER_PROGRAMMING_ATTEMPTS);
+} // end of negotiateSpeed
+
+// returns true if managed to enter programming mode
+bool startProgramming()
+{
+
+	// ON Burn Buffer
+	PORTB |= 0b00000001;
+
+	BB_ISP::Hold_Reset();
 
-	return true; // entered programming mode OK
+	// already negotiated with this target? go straight back to that speed
+	if (ispSpeedLocked)
+	{
+		startTransport(ispTransport);
+		setISPSpeed(ispSpeed);
+		if (syncTarget(ENTER_PROGRAMMING_ATTEMPTS))
+			return true;
+		stopTransport();
+		ispSpeedLocked = false;
+	} // end of locked speed
+
+#if ISP_TRANSPORT != ISP_BITBANG
+	// hardware transport first
+	startTransport(ISP_TRANSPORT);
+	if (findSpeed(HW_PROGRAMMING_ATTEMPTS))
+		return negotiateSpeed();
+	stopTransport();
+#endif
+
+	// bit banged fallback
+	startTransport(ISP_BITBANG);
+	if (!findSpeed(ENTER_PROGRAMMING_ATTEMPTS))
+		return false;
+	return negotiateSpeed(); // entered programming mode OK?
 } // end of startProgramming
 
 void stopProgramming()
 {
-	// turn off pull-ups
-	digitalWrite(RESET, LOW);
-	digitalWrite(MSPIM_SCK, LOW);
-	digitalWrite(BB_MOSI, LOW);
-	digitalWrite(BB_MISO, LOW);
-
-	// set everything back to inputs
-	pinMode(RESET, INPUT);
-	pinMode(MSPIM_SCK, INPUT);
-	pinMode(BB_MOSI, INPUT);
-	pinMode(BB_MISO, INPUT);
+	BB_ISP::Release_Reset();
 
+	stopTransport();
+	ispSpeedLocked = false; // next target may be different
+	foundSig = -1;
 } // end of stopProgramming
 
 void getSignature()
@@ -844,24 +2839,46 @@ void getSignature()
 	foundSig = -1;
 	lastAddressMSB = 0;
 
+	// the lead's signature, and any target that is not the same chip
 	byte sig[3];
+	byte different = 0;
 	for (byte i = 0; i < 3; i++)
 	{
 		sig[i] = program(readSignatureByte, 0, i);
+		different |= gangActive & ~answering(sig[i], sig[i]);
 	} // end for each signature byte
 
-	for (unsigned int j = 0; j < NUMITEMS(signatures); j++)
+	// a different chip can't be left out of the erase and the writes on the
+	//  shared lines, so there is no session with it on the header
+	if (different != 0)
+	{
+		dropTargets(different, gangSignature);
+		ShowMessage(MSG_UNRECOGNIZED_SIGNATURE);
+		return;
+	} // end of mixed chips
+
+	// binary search the keys, only the matching entry is copied out
+	unsigned int low = 0;
+	unsigned int high = NUMITEMS(signatureKeys);
+	while (low < high)
 	{
-		memcpy_P(&currentSignature, &signatures[j], sizeof currentSignature);
+		const unsigned int j = (low + high) / 2;
+		const int diff = memcmp_P(sig, signatureKeys[j], sizeof sig);
 
-		if (memcmp(sig, currentSignature.sig, sizeof sig) == 0)
+		if (diff == 0)
 		{
+			memcpy_P(&currentSignature, &signatures[j], sizeof currentSignature);
 			foundSig = j;
 			// make sure extended address is zero to match lastAddressMSB variable
 			program(loadExtendedAddressByte, 0, 0);
 			return;
 		} // end of signature found
-	}	  // end of for each signature
+
+		if (diff < 0)
+			high = j;
+		else
+			low = j + 1;
+	} // end of while searching
 
 	ShowMessage(MSG_UNRECOGNIZED_SIGNATURE);
 } // end of getSignature
@@ -875,6 +2892,25 @@ void getFuseBytes()
 	fuses[calibrationByte] = program(readCalibrationByte);
 } // end of getFuseBytes
 
+// drop the targets whose fuse and lock bytes are not what the lead's are
+//  once the session has written them
+void checkFuses()
+{
+	if (GANG_TARGETS == 1)
+		return; // nothing to compare with
+
+	byte wrong = 0;
+	byte b = program(readLowFuseByte, readLowFuseByteArg2);
+	wrong |= gangActive & ~answering(b, b);
+	b = program(readHighFuseByte, readHighFuseByteArg2);
+	wrong |= gangActive & ~answering(b, b);
+	b = program(readExtendedFuseByte, readExtendedFuseByteArg2);
+	wrong |= gangActive & ~answering(b, b);
+	b = program(readLockByte, readLockByteArg2);
+	wrong |= gangActive & ~answering(b, b);
+	dropTargets(wrong, gangFuses);
+} // end of checkFuses
+
 // write specified value to specified fuse/lock byte
 void writeFuse(const byte newValue, const byte instruction)
 {
@@ -882,15 +2918,45 @@ void writeFuse(const byte newValue, const byte instruction)
 		return; // ignore
 
 	program(progamEnable, instruction, 0, newValue);
-	pollUntilReady();
+	if (!pollUntilReady(busyFuse))
+		return; // writeFlashContents reports it
+
+	// CKSEL and CKDIV8 are in the low fuse, the new clock takes effect on the
+	//  next reset so renegotiate the ISP speed from scratch
+	if (instruction == writeLowFuseByte)
+	{
+		ispSpeedLocked = false;
+		startProgramming();
+	} // end of clock may have changed
 } // end of writeFuse
 
+// boot size fuse bits for lowestAddress (0 to 3), or one of these
+const byte BOOT_NONE = 0x80; // starts at 0, don't use bootloader
+const byte BOOT_BAD = 0xFF;	 // not the start of any boot size
+
+byte bootSize; // decided by chooseInputFile, see updateFuses
+
+byte decideBootSize()
+{
+	const unsigned long addr = currentSignature.flashSize;
+	const unsigned int len = currentSignature.baseBootSize;
+
+	if (lowestAddress == 0)
+		return BOOT_NONE;
+	if (lowestAddress == (addr - len))
+		return 3;
+	if (lowestAddress == (addr - len * 2))
+		return 2;
+	if (lowestAddress == (addr - len * 4))
+		return 1;
+	if (lowestAddress == (addr - len * 8))
+		return 0;
+	return BOOT_BAD;
+} // end of decideBootSize
+
 // returns true if error, false if OK
 bool updateFuses(const bool writeIt)
 {
-	unsigned long addr;
-	unsigned int len;
-
 	byte fusenumber = currentSignature.fuseWithBootloaderSize;
 
 	// if no fuse, can't change it
@@ -900,39 +2966,21 @@ bool updateFuses(const bool writeIt)
 		return false; // ok return
 	}
 
-	addr = currentSignature.flashSize;
-	len = currentSignature.baseBootSize;
+	if (bootSize == BOOT_BAD)
+	{
+		ShowMessage(MSG_BAD_START_ADDRESS);
+		return true;
+	}
 
-	if (lowestAddress == 0)
+	if (bootSize == BOOT_NONE)
 	{
 		// don't use bootloader
 		fuses[fusenumber] |= 1;
 	}
 	else
 	{
-		byte newval = 0xFF;
-
-		if (lowestAddress == (addr - len))
-			newval = 3;
-		else if (lowestAddress == (addr - len * 2))
-			newval = 2;
-		else if (lowestAddress == (addr - len * 4))
-			newval = 1;
-		else if (lowestAddress == (addr - len * 8))
-			newval = 0;
-		else
-		{
-			ShowMessage(MSG_BAD_START_ADDRESS);
-			return true;
-		}
-
-		if (newval != 0xFF)
-		{
-			newval <<= 1;
-			fuses[fusenumber] &= ~0x07; // also program (clear) "boot into bootloader" bit
-			fuses[fusenumber] |= newval;
-		} // if valid
-
+		fuses[fusenumber] &= ~0x07; // also program (clear) "boot into bootloader" bit
+		fuses[fusenumber] |= bootSize << 1;
 	} // if not address 0
 
 	if (writeIt)
@@ -943,6 +2991,20 @@ bool updateFuses(const bool writeIt)
 	return false;
 } // end of updateFuses
 
+// write the fuse and lock bytes the .pfw file asks for, lock byte last
+void writePfwFuses()
+{
+	if (!pfwReady)
+		return;
+
+	for (byte i = lowFuse; i <= lockByte; i++)
+		if ((pfwHeader.fuseMask & currentSignature.fuseMask & bit(i)) && pfwHeader.fuses[i] != fuses[i])
+		{
+			fuses[i] = pfwHeader.fuses[i];
+			writeFuse(fuses[i], fuseCommands[i]);
+		} // end of fuse to change
+} // end of writePfwFuses
+
 //------------------------------------------------------------------------------
 //      SETUP
 //------------------------------------------------------------------------------
@@ -962,6 +3024,9 @@ void setup() {
 	pinMode(readyLED, OUTPUT);//Yeşil
 	pinMode(workingLED, OUTPUT);//Mavi
 
+	// status messages play in the background from here on
+	startLEDTimer();
+
 	// initialize the SD card at SPI_HALF_SPEED to avoid bus errors with
 	// breadboards.  use SPI_FULL_SPEED for better performance.
 	if (!sd.begin(10)) {
@@ -975,11 +3040,138 @@ void setup() {
 
 } // end of setup
 
+// identifies the input file, and the chip it was checked for
+typedef struct
+{
+	uint32_t size;
+	uint16_t date, time; // last modified, FAT format
+	uint32_t firstCRC;	 // CRC-32 of the first VALIDATION_BLOCK bytes
+	byte sig[3];
+	bool pfw; // fw.pfw rather than fw.hex
+} validationKeyType;
+
+// what the check pass found out about that file
+typedef struct
+{
+	validationKeyType key;
+	unsigned long lowestAddress;
+	unsigned long highestAddress;
+	unsigned long bytesWritten;
+	byte bootSize;		  // see decideBootSize
+	bool imageReady;	  // the check pass left a page image
+	uint32_t imageMapCRC; // and its page map CRC, for the journal
+	byte magic;			  // VALIDATION_MAGIC
+} validationType;
+
+validationType validation; // this session's input file
+bool validationNew;		   // found by the check pass, to be kept
+
+int validationAt()
+{
+	return JOURNAL_HEADERS * sizeof(journalHeaderType) + JOURNAL_SLOTS * sizeof(journalRecordType);
+} // end of validationAt
+
+// size and modified time of the input file, and its first block if
+//  "readFirst" (the card read is left until it is needed)
+bool validationKey(validationKeyType &key, const bool readFirst)
+{
+	SdFile file;
+	byte chunk[32];
+
+	memset(&key, 0, sizeof key);
+	if (!file.open(pfwReady ? pfwFile : wantedFile, O_READ) || !file.getModifyDateTime(&key.date, &key.time))
+		return false;
+	key.size = file.fileSize();
+
+	key.firstCRC = 0xFFFFFFFF;
+	for (unsigned int done = 0; readFirst && done < VALIDATION_BLOCK; done += sizeof chunk)
+	{
+		const int count = file.read(chunk, sizeof chunk);
+		if (count <= 0)
+			break; // short file
+		key.firstCRC = crc32Update(key.firstCRC, chunk, count);
+	} // end of for each chunk
+	file.close();
+
+	memcpy(key.sig, currentSignature.sig, sizeof key.sig);
+	key.pfw = pfwReady;
+	return true;
+} // end of validationKey
+
+// true if the file was checked before and nothing it depends on changed,
+//  then takes the check pass's findings from EEPROM
+bool validatedBefore()
+{
+	validationType kept;
+	EEPROM.get(validationAt(), kept);
+
+	// the first block is only read if the rest of the key matches
+	validation.key.firstCRC = kept.key.firstCRC;
+	if (kept.magic != VALIDATION_MAGIC || memcmp(&kept.key, &validation.key, sizeof kept.key) != 0 ||
+		!validationKey(validation.key, true) || validation.key.firstCRC != kept.key.firstCRC)
+		return false;
+
+	// the page image has to be the one that check pass left
+	if (kept.imageReady)
+	{
+		SdFile image;
+		imageHeaderType header;
+		const bool same = image.open(imageFile, O_READ) &&
+						  image.read(&header, sizeof header) == (int)sizeof header &&
+						  header.magic == IMAGE_MAGIC && header.pageSize == currentSignature.pageSize &&
+						  header.lowestAddress == kept.lowestAddress &&
+						  header.highestAddress == kept.highestAddress && header.bytesWritten == kept.bytesWritten;
+		image.close();
+		if (!same)
+			return false;
+	} // end of page image
+
+	lowestAddress = kept.lowestAddress;
+	highestAddress = kept.highestAddress;
+	bytesWritten = kept.bytesWritten;
+	bootSize = kept.bootSize;
+	imageReady = kept.imageReady;
+	imageMapCRC = kept.imageMapCRC;
+	return true;
+} // end of validatedBefore
+
+// keep what the check pass found, between sessions (each byte takes 3.4 mS)
+// only if the file is still on the card, a target that flashed OK takes
+//  it away; and still the one that was checked
+void saveValidation()
+{
+	if (!validationNew)
+		return;
+	validationNew = false;
+
+	validationKeyType key;
+	if (!validationKey(key, true) || key.size != validation.key.size || key.date != validation.key.date ||
+		key.time != validation.key.time)
+		return;
+	validation.key = key;
+
+	// not valid until the last byte is written
+	validation.magic = 0;
+	EEPROM.put(validationAt(), validation);
+	EEPROM.update(validationAt() + offsetof(validationType, magic), VALIDATION_MAGIC);
+} // end of saveValidation
+
 // returns true if error, false if OK
 bool chooseInputFile()
 {
 
-	if (readHexFile(name, checkFile))
+	// a .pfw file takes the place of the .hex file
+	pfwReady = findPfw();
+
+	// checked in an earlier session? nothing to parse then
+	const bool keyed = validationKey(validation.key, false);
+	if (keyed && validatedBefore())
+	{
+		stats.checkSkipped = true;
+		return false;
+	}
+
+	if (readHexFile(checkFile))
 	{
 		return true; // error, don't attempt to write
 	}
@@ -992,11 +3184,20 @@ bool chooseInputFile()
 	}
 
 	// check start address makes sense
+	bootSize = decideBootSize();
 	if (updateFuses(false))
 	{
 		return true;
 	}
 
+	// for the next session, see saveValidation
+	validation.lowestAddress = lowestAddress;
+	validation.highestAddress = highestAddress;
+	validation.bytesWritten = bytesWritten;
+	validation.bootSize = bootSize;
+	validation.imageReady = imageReady;
+	validation.imageMapCRC = imageMapCRC;
+	validationNew = keyed;
 	return false;
 } // end of chooseInputFile
 
@@ -1005,7 +3206,9 @@ bool writeFlashContents()
 {
 
 	errors = 0;
+	memset(&stats, 0, sizeof stats);
 
+	startPhase(phaseCheck);
 	if (chooseInputFile())
 		return false;
 
@@ -1017,36 +3220,170 @@ bool writeFlashContents()
 	if (!startProgramming())
 		return false;
 
+	// target already holds this image? then leave the flash alone
+	if (COMPARE_BEFORE_WRITE)
+	{
+		startPhase(phaseCompare);
+		if (readHexFile(compareFlash))
+			return false;
+
+		if (errors == 0)
+		{
+			stats.unchanged = true;
+			startPhase(phaseFuses);
+			updateFuses(true);
+			writePfwFuses();
+			checkFuses();
+			if (stats.timeouts > 0)
+			{
+				ShowMessage(MSG_TARGET_NOT_READY);
+				return false;
+			} // end of fuse write never finished
+			if (!gangComplete())
+				return false; // keep the files for another go
+			sd.remove("fw.hex");
+			sd.remove(imageFile);
+			sd.remove(pfwFile);
+			return true;
+		} // end of target matches
+	} // end of compare before write
+
 	// now commit to flash
-	if (readHexFile(name, writeToFlash))
+	if (readHexFile(writeToFlash))
 		return false;
 
 #if CROSSROADS_PROGRAMMING_BOARD
 	show7SegmentMessage("uF");
 #endif //  CROSSROADS_PROGRAMMING_BOARD
 
-	// turn ready LED on during verification
-	digitalWrite(readyLED, HIGH);
+	// each page was read back as it was written
+	if (!VERIFY_ON_WRITE)
+	{
+		// turn ready LED on during verification
+		digitalWrite(readyLED, HIGH);
 
-	// verify
-	if (readHexFile(name, verifyFlash))
-		return false;
+		// verify
+		startPhase(phaseVerify);
+		if (readHexFile(verifyFlash))
+			return false;
+	} // end of separate verify pass
 
 	// now fix up fuses so we can boot
 	if (errors == 0)
+	{
+		startPhase(phaseFuses);
 		updateFuses(true);
+		writePfwFuses();
+		checkFuses();
+	}
+
+	if (stats.timeouts > 0)
+	{
+		ShowMessage(MSG_TARGET_NOT_READY);
+		return false;
+	} // end of fuse write never finished
+
+	if (errors == 0 && !gangComplete())
+		return false; // keep the files for another go
 
 	if(errors == 0){
 		sd.remove("fw.hex");
+		sd.remove(imageFile);
+		sd.remove(pfwFile);
 		return true;
 	}
+
+	return false;
 } // end of writeFlashContents
 
+// append "label=shortest/average/longest" busy times (uS) to the log
+void logBusy(ofstream &sdout, const __FlashStringHelper *label, const busyStatsType &b)
+{
+	if (b.count == 0)
+		return; // no writes of this kind
+
+	sdout << label << b.shortest << '/' << b.total / b.count << '/' << b.longest;
+} // end of logBusy
+
+// append "label=mS" for a phase that ran
+void logPhase(ofstream &sdout, const __FlashStringHelper *label, const byte which)
+{
+	if (stats.phaseMicros[which] == 0)
+		return; // skipped
+
+	sdout << label << (stats.phaseMicros[which] + 500) / 1000;
+} // end of logPhase
+
+#if GANG_TARGETS > 1
+// append "targets=" and how each target of the gang fared
+void logTargets(ofstream &sdout)
+{
+	sdout << F(" targets=");
+	for (byte t = 0; t < GANG_TARGETS; t++)
+	{
+		if (t > 0)
+			sdout << ',';
+		switch (gangResult[t])
+		{
+		case gangOK:
+			sdout << F("OK");
+			break;
+		case gangNoTarget:
+			sdout << F("none");
+			break;
+		case gangSignature:
+			sdout << F("signature");
+			break;
+		case gangNotReady:
+			sdout << F("notReady");
+			break;
+		case gangVerify:
+			sdout << F("verify");
+			break;
+		default:
+			sdout << F("fuses");
+			break;
+		} // end of switch on result
+	}	  // end of for each target
+} // end of logTargets
+#endif
+
+// append a summary of this session to logFile
+void logSession(const bool ok)
+{
+	ofstream sdout(logFile, ios::out | ios::app);
+
+	sdout << (ok ? F("OK") : F("FAILED"))
+		  << (stats.unchanged ? F(" unchanged") : F(""))
+		  << (stats.checkSkipped ? F(" checkSkipped") : F(""))
+		  << F(" pagesWritten=") << stats.pagesWritten
+		  << F(" pagesSkipped=") << stats.pagesSkipped
+		  << F(" pagesMatched=") << stats.pagesMatched
+		  << F(" pagesResumed=") << stats.pagesResumed
+		  << F(" pagesRetried=") << stats.pagesRetried
+		  << F(" pagesFailed=") << stats.pagesFailed
+		  << F(" timeouts=") << stats.timeouts;
+	logBusy(sdout, F(" flashUs="), stats.busy[busyFlash]);
+	logBusy(sdout, F(" eraseUs="), stats.busy[busyErase]);
+	logBusy(sdout, F(" fuseUs="), stats.busy[busyFuse]);
+	logPhase(sdout, F(" checkMs="), phaseCheck);
+	logPhase(sdout, F(" compareMs="), phaseCompare);
+	logPhase(sdout, F(" eraseMs="), phaseErase);
+	logPhase(sdout, F(" writeMs="), phaseWrite);
+	logPhase(sdout, F(" verifyMs="), phaseVerify);
+	logPhase(sdout, F(" fusesMs="), phaseFuses);
+#if GANG_TARGETS > 1
+	logTargets(sdout);
+#endif
+	sdout << '\n';
+} // end of logSession
+
 //------------------------------------------------------------------------------
 //      LOOP
 //------------------------------------------------------------------------------
 void loop() {
 
+	startGang();
 	if (!startProgramming()) {
 
 		ShowMessage(MSG_CANNOT_ENTER_PROGRAMMING_MODE);
@@ -1058,19 +3395,17 @@ void loop() {
 	getSignature();
 	getFuseBytes();
 
-	// don't have signature? don't proceed
+	// don't have signature? don't proceed (getSignature has said why)
 	if (foundSig == -1)
-	{
-		ShowMessage(MSG_CANNOT_FIND_SIGNATURE);
 		return;
-	} // end of no signature
 
 	digitalWrite(workingLED, HIGH);
 	bool ok = writeFlashContents();
+	startPhase(phases);
 	digitalWrite(workingLED, LOW);
 	digitalWrite(readyLED, LOW);
 	stopProgramming();
-	delay(500);
+	logSession(ok);
 
 	if (ok)	{
 		ShowMessage(MSG_FLASHED_OK);
@@ -1079,7 +3414,10 @@ void loop() {
 	// Done Signal [HIGH]
 	PORTB |= 0b00000010;
 
-	// Sleep Delay
-	delay(200);
+	// Sleep Delay, less the time the last EEPROM writes took
+	const unsigned long sleepStart = millis();
+	flushJournal();
+	saveValidation();
+	delay(200 - min(millis() - sleepStart, 200UL));
 
 } // end of loop
\ No newline at end of file
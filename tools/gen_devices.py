@@ -0,0 +1,223 @@
+# gen_devices - build include/devices.h from tools/devices.conf
+#
+# The programmer's device table used to be written by hand, with the chip
+#  names as string literals in RAM. This reads the parts from an
+#  avrdude.conf style file (see the top of devices.conf for the keywords)
+#  and writes them out as DEVICE_LIST, which each firmware expands into its
+#  own PROGMEM table with the names in flash as well. The list is sorted by
+#  signature so that the firmware can binary search it.
+#
+# run:  python tools/gen_devices.py [devices.conf [devices.h]]
+#
+# platformio.ini also runs it as a pre: extra script, so a changed
+#  devices.conf is picked up by the next build.
+
+import os
+import re
+import sys
+
+FUSES = ["lfuse", "hfuse", "efuse", "lock"]  # same order as the fuses array
+NO_FUSE = 0xFF
+POLL_RDY_BSY = 0x40  # flash "mode" bit: page write finishes can be polled
+
+TOKEN = re.compile(r'\s*(?:#[^\n]*|"([^"]*)"|([=;])|([^\s=;"#]+))')
+
+
+class ConfError(Exception):
+    pass
+
+
+def tokens(text):
+    pos = 0
+    while pos < len(text):
+        m = TOKEN.match(text, pos)
+        if not m or m.end() == pos:
+            if text[pos:].strip() == "":
+                return
+            raise ConfError("cannot read %r" % text[pos:pos + 20])
+        pos = m.end()
+        if m.group(1) is not None:
+            yield ("string", m.group(1))
+        elif m.group(2):
+            yield (m.group(2), m.group(2))
+        elif m.group(3):
+            yield ("word", m.group(3))
+
+
+def number(value):
+    try:
+        return int(value, 0)
+    except ValueError:
+        raise ConfError("not a number: %s" % value)
+
+
+def parse(text):
+    """returns the parts in file order, each {key: [values], "memory": {name: {key: [values]}}}"""
+    parts = []
+    byId = {}
+    toks = list(tokens(text))
+    i = 0
+
+    def assignment(into):
+        # key = value [value ...] ;
+        nonlocal i
+        key = toks[i][1]
+        if i + 1 >= len(toks) or toks[i + 1][0] != "=":
+            raise ConfError("expected = after %s" % key)
+        i += 2
+        values = []
+        while i < len(toks) and toks[i][0] != ";":
+            values.append(toks[i][1])
+            i += 1
+        i += 1
+        into[key] = values
+
+    while i < len(toks):
+        if toks[i] != ("word", "part"):
+            raise ConfError("expected part, got %s" % toks[i][1])
+        i += 1
+
+        part = {"memory": {}}
+        if toks[i] == ("word", "parent"):
+            parent = byId.get(toks[i + 1][1])
+            if parent is None:
+                raise ConfError("unknown parent %s" % toks[i + 1][1])
+            part = {k: list(v) for k, v in parent.items() if k != "memory"}
+            part["memory"] = {m: dict(v) for m, v in parent["memory"].items()}
+            i += 2
+
+        while toks[i][0] != ";":
+            if toks[i] == ("word", "memory"):
+                memory = part["memory"].setdefault(toks[i + 1][1], {})
+                i += 2
+                while toks[i][0] != ";":
+                    assignment(memory)
+                i += 1
+            else:
+                assignment(part)
+        i += 1
+
+        if "id" not in part:
+            raise ConfError("part without an id")
+        byId[part["id"][0]] = part
+        parts.append(part)
+
+    return parts
+
+
+def device(part):
+    """one DEVICE (...) row, see the comment written at the top of devices.h"""
+    name = part["desc"][0]
+    memory = part["memory"]
+
+    def get(block, key, default=None):
+        values = block.get(key)
+        if values is None:
+            if default is None:
+                raise ConfError("%s: no %s" % (name, key))
+            return default
+        return number(values[0])
+
+    flash = memory.get("flash")
+    eeprom = memory.get("eeprom", {})
+    if flash is None:
+        raise ConfError("%s: no flash memory" % name)
+
+    sig = [number(b) for b in part.get("signature", [])]
+    if len(sig) != 3:
+        raise ConfError("%s: signature must be 3 bytes" % name)
+
+    bootFuse = part.get("boot_fuse", [None])[0]
+    if bootFuse is not None and bootFuse not in FUSES[:3]:
+        raise ConfError("%s: boot_fuse must be lfuse, hfuse or efuse" % name)
+
+    fuseMask = 0
+    fuseDelay = 0
+    for bit, fuse in enumerate(FUSES):
+        if fuse in memory:
+            fuseMask |= 1 << bit
+            fuseDelay = max(fuseDelay, get(memory[fuse], "max_write_delay", 0))
+
+    return [
+        part["id"][0],
+        "0x%02X" % sig[0], "0x%02X" % sig[1], "0x%02X" % sig[2],
+        '"%s"' % name,
+        get(flash, "size"),
+        get(eeprom, "size", 0),
+        get(flash, "page_size"),
+        get(eeprom, "page_size", 0),
+        number(part.get("boot_size", ["0"])[0]),
+        "0x%02X" % (FUSES.index(bootFuse) if bootFuse else NO_FUSE),
+        "0x%02X" % fuseMask,
+        0 if get(flash, "mode", POLL_RDY_BSY) & POLL_RDY_BSY else 1,
+        get(flash, "max_write_delay"),
+        number(part["chip_erase_delay"][0]),
+        fuseDelay,
+        number(part["reset_settle"][0]),
+    ]
+
+
+HEADER = """\
+// AVR parts the programmer knows about
+//
+// generated by tools/gen_devices.py from tools/devices.conf, do not edit
+//
+// DEVICE (id, signature 0, 1, 2, name, flash size, EEPROM size, flash page
+//	 size, EEPROM page size, boot size, boot fuse, fuses present, timed writes,
+//	 tWD_FLASH uS, tWD_ERASE uS, tWD_FUSE uS, reset settle mS)
+//
+// boot fuse is 0 to 2 for the low, high and extended fuse (0xFF: no
+//	bootloader section), bit 0 to 3 of fuses present stand for the low, high
+//	and extended fuse and the lock byte; timed writes is 1 for chips without
+//	Poll RDY/BSY. Each firmware expands DEVICE_LIST into its own signature
+//	table, with the names in PROGMEM.
+//
+// Sorted by signature, the firmware binary searches it.
+
+#ifndef devices_h
+#define devices_h
+
+#define DEVICE_LIST(DEVICE) \\
+"""
+
+
+def generate(confName, headerName):
+    with open(confName) as f:
+        parts = parse(f.read())
+
+    rows = sorted((device(part) for part in parts), key=lambda row: row[1:4])
+    for a, b in zip(rows, rows[1:]):
+        if a[1:4] == b[1:4]:
+            raise ConfError("%s and %s have the same signature" % (a[4], b[4]))
+    lines = ["\tDEVICE (%s) \\" % ", ".join(str(v) for v in row) for row in rows]
+
+    with open(headerName, "w") as f:
+        f.write(HEADER)
+        f.write("\n".join(lines) + "\n\n#endif\n")
+
+    return len(rows)
+
+
+def main(args):
+    here = os.path.dirname(os.path.abspath(sys.argv[0]))
+    confName = args[0] if len(args) > 0 else os.path.join(here, "devices.conf")
+    headerName = args[1] if len(args) > 1 else os.path.join(here, "..", "include", "devices.h")
+    try:
+        count = generate(confName, headerName)
+    except (ConfError, IndexError, KeyError) as e:
+        sys.stderr.write("%s: %s\n" % (confName, e or "unexpected end of file"))
+        return 1
+    print("%s: %d devices" % (headerName, count))
+    return 0
+
+
+try:
+    Import("env")  # run by PlatformIO as an extra script
+except NameError:
+    sys.exit(main(sys.argv[1:]))
+else:
+    projectDir = env.subst("$PROJECT_DIR")
+    confName = os.path.join(projectDir, "tools", "devices.conf")
+    headerName = os.path.join(projectDir, "include", "devices.h")
+    if not os.path.exists(headerName) or os.path.getmtime(confName) > os.path.getmtime(headerName):
+        generate(confName, headerName)
@@ -0,0 +1,391 @@
+// hex2pfw - convert an Intel .hex file into a .pfw firmware container
+//
+// The programmer reads fw.pfw instead of fw.hex when it is on the card: no
+//  ASCII to decode, about half the bytes to read, and a CRC-32 per page.
+//
+// build:  g++ -O2 -o hex2pfw tools/hex2pfw.cpp
+//
+// usage:  hex2pfw -s 1E950F -f 32768 -p 128 [-L xx] [-H xx] [-E xx] [-K xx] [-z 1] in.hex out.pfw
+//
+//   -s  target signature (3 bytes, hex)
+//   -f  target flash size, bytes
+//   -p  target flash page size, bytes
+//   -L / -H / -E / -K  low, high, extended fuse and lock byte to write after
+//       programming (hex, optional)
+//   -z 1  compress each page (magic "PFWZ")
+//
+// File layout (little-endian, see pfwHeaderType / pfwPageType in src/main.cpp):
+//
+//   header  magic "PFW1", signature, fuse mask, fuses, flash size, page size,
+//           page count, lowest / highest address, data bytes, CRC-32 of the
+//           rest of the file
+//   pages   for each page holding data, in address order: address, CRC-32
+//           of the page, then the page itself (0xFF where the file has no data)
+//
+// A compressed file has the same header with magic "PFWZ". Each page entry
+//  then also holds the compressed length (32 bits), and the page is LZ
+//  compressed on its own so that the programmer needs no window beyond its
+//  page buffer; see packPage below and unpackPage in src/main.cpp.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include <map>
+#include <vector>
+
+static const uint32_t PFW_MAGIC = 0x31574650;  // "PFW1"
+static const uint32_t PFWZ_MAGIC = 0x5A574650; // "PFWZ"
+static const unsigned MAX_PAGE_SIZE = 256;	   // pageBuffer on the programmer
+
+// same order as the fuses array on the programmer
+enum
+{
+	lowFuse,
+	highFuse,
+	extFuse,
+	lockByte
+};
+
+typedef std::map<uint32_t, std::vector<uint8_t> > pageMap;
+
+// CRC-32 as used by zip, start with 0xFFFFFFFF and invert the result
+static uint32_t crc32Update(uint32_t crc, const uint8_t *p, size_t length)
+{
+	while (length--)
+	{
+		crc ^= *p++;
+		for (int i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ (0xEDB88320 & -(crc & 1));
+	} // end of while
+	return crc;
+} // end of crc32Update
+
+static void put16(std::vector<uint8_t> &out, uint32_t v)
+{
+	out.push_back(v & 0xFF);
+	out.push_back((v >> 8) & 0xFF);
+} // end of put16
+
+static void put32(std::vector<uint8_t> &out, uint32_t v)
+{
+	put16(out, v & 0xFFFF);
+	put16(out, v >> 16);
+} // end of put32
+
+// compress a page, tokens are:
+//   0nnnnnnn             n + 1 literal bytes follow
+//   1nnnnnnn oooooooo    copy n + 3 bytes from o + 1 bytes back in the page
+static std::vector<uint8_t> packPage(const std::vector<uint8_t> &page)
+{
+	std::vector<uint8_t> out;
+	size_t literals = 0; // pending, not yet written
+	size_t pos = 0;
+
+	while (pos <= page.size())
+	{
+		size_t bestLength = 0;
+		size_t bestBack = 0;
+
+		// longest earlier match, the copy may overlap
+		for (size_t back = 1; back <= 256 && back <= pos && pos < page.size(); back++)
+		{
+			size_t length = 0;
+			while (length < 130 && pos + length < page.size() &&
+				   page[pos + length] == page[pos + length - back])
+				length++;
+			if (length > bestLength)
+			{
+				bestLength = length;
+				bestBack = back;
+			}
+		} // end of for each distance
+
+		// flush literals before a match, at the end, or when the run is full
+		if (literals > 0 && (bestLength >= 3 || pos == page.size() || literals == 128))
+		{
+			out.push_back(literals - 1);
+			out.insert(out.end(), page.begin() + pos - literals, page.begin() + pos);
+			literals = 0;
+		}
+
+		if (pos == page.size())
+			break;
+
+		if (bestLength >= 3)
+		{
+			out.push_back(0x80 | (bestLength - 3));
+			out.push_back(bestBack - 1);
+			pos += bestLength;
+		}
+		else
+		{
+			literals++;
+			pos++;
+		}
+	} // end of while
+
+	return out;
+} // end of packPage
+
+static int hexValue(const char *p, int digits)
+{
+	int value = 0;
+	for (int i = 0; i < digits; i++)
+	{
+		if (!isxdigit((unsigned char)p[i]))
+			return -1;
+		value = value * 16 + (isdigit((unsigned char)p[i]) ? p[i] - '0' : toupper((unsigned char)p[i]) - 'A' + 10);
+	} // end of for each digit
+	return value;
+} // end of hexValue
+
+static void usage()
+{
+	fprintf(stderr, "usage: hex2pfw -s signature -f flashsize -p pagesize "
+					"[-L lfuse] [-H hfuse] [-E efuse] [-K lock] [-z 1] in.hex out.pfw\n");
+	exit(2);
+} // end of usage
+
+// read the .hex file into pages, returns false on error
+static bool readHex(const char *fName, uint32_t pageSize, pageMap &pages,
+					uint32_t &lowest, uint32_t &highest, uint32_t &dataBytes)
+{
+	FILE *in = fopen(fName, "r");
+	if (!in)
+	{
+		perror(fName);
+		return false;
+	}
+
+	char line[600];
+	unsigned lineNumber = 0;
+	uint32_t extended = 0;
+	bool gotEndOfFile = false;
+
+	while (fgets(line, sizeof line, in))
+	{
+		lineNumber++;
+
+		size_t length = strlen(line);
+		while (length > 0 && isspace((unsigned char)line[length - 1]))
+			line[--length] = 0;
+		if (length == 0)
+			continue; // empty line
+
+		uint8_t record[260];
+		int count = 0;
+		uint8_t sum = 0;
+
+		if (line[0] != ':' || (length - 1) % 2 != 0 || (length - 1) / 2 > sizeof record)
+		{
+			fprintf(stderr, "%s:%u: not a .hex record\n", fName, lineNumber);
+			fclose(in);
+			return false;
+		}
+
+		for (size_t i = 1; i < length; i += 2)
+		{
+			int b = hexValue(&line[i], 2);
+			if (b < 0)
+			{
+				fprintf(stderr, "%s:%u: invalid hex digits\n", fName, lineNumber);
+				fclose(in);
+				return false;
+			}
+			record[count++] = b;
+			sum += b;
+		} // end of for each byte
+
+		if (count < 5 || sum != 0 || record[0] != count - 5)
+		{
+			fprintf(stderr, "%s:%u: bad length or sumcheck\n", fName, lineNumber);
+			fclose(in);
+			return false;
+		}
+
+		uint32_t addr = (record[1] << 8) | record[2];
+		uint8_t len = record[0];
+
+		switch (record[3])
+		{
+		case 0: // data
+			addr += extended;
+			if (addr < lowest)
+				lowest = addr;
+			if (addr + len - 1 > highest)
+				highest = addr + len - 1;
+			dataBytes += len;
+
+			for (int i = 0; i < len; i++)
+			{
+				std::vector<uint8_t> &page = pages[(addr + i) & ~(pageSize - 1)];
+				if (page.empty())
+					page.assign(pageSize, 0xFF);
+				page[(addr + i) & (pageSize - 1)] = record[4 + i];
+			} // end of for each data byte
+			break;
+
+		case 1: // end of file
+			gotEndOfFile = true;
+			break;
+
+		case 2: // extended segment address
+			extended = ((record[4] << 8) | record[5]) << 4;
+			break;
+
+		case 4: // extended linear address
+			extended = ((record[4] << 8) | record[5]) << 16;
+			break;
+
+		case 3: // start segment address
+		case 5: // start linear address
+			break;
+
+		default:
+			fprintf(stderr, "%s:%u: unknown record type %u\n", fName, lineNumber, record[3]);
+			fclose(in);
+			return false;
+		} // end of switch on record type
+	}	  // end of while each line
+
+	fclose(in);
+
+	if (!gotEndOfFile)
+	{
+		fprintf(stderr, "%s: no end of file record\n", fName);
+		return false;
+	}
+
+	return true;
+} // end of readHex
+
+int main(int argc, char **argv)
+{
+	int sig[3] = {-1, -1, -1};
+	uint32_t flashSize = 0;
+	uint32_t pageSize = 0;
+	uint8_t fuseMask = 0;
+	uint8_t fuses[4] = {0};
+	bool packed = false;
+
+	int arg = 1;
+	for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+	{
+		const char *value = argv[arg + 1];
+		int fuse = -1;
+
+		switch (argv[arg][1])
+		{
+		case 's':
+			if (strlen(value) != 6)
+				usage();
+			for (int i = 0; i < 3; i++)
+				sig[i] = hexValue(&value[i * 2], 2);
+			break;
+		case 'f':
+			flashSize = strtoul(value, NULL, 0);
+			break;
+		case 'p':
+			pageSize = strtoul(value, NULL, 0);
+			break;
+		case 'L':
+			fuse = lowFuse;
+			break;
+		case 'H':
+			fuse = highFuse;
+			break;
+		case 'E':
+			fuse = extFuse;
+			break;
+		case 'K':
+			fuse = lockByte;
+			break;
+		case 'z':
+			packed = strtoul(value, NULL, 0) != 0;
+			break;
+		default:
+			usage();
+		} // end of switch on option
+
+		if (fuse >= 0)
+		{
+			fuses[fuse] = strtoul(value, NULL, 16);
+			fuseMask |= 1 << fuse;
+		}
+	} // end of for each option
+
+	if (argc - arg != 2 || sig[0] < 0 || sig[1] < 0 || sig[2] < 0 || flashSize == 0)
+		usage();
+
+	if (pageSize == 0 || pageSize > MAX_PAGE_SIZE || (pageSize & (pageSize - 1)) != 0)
+	{
+		fprintf(stderr, "page size must be a power of 2, at most %u\n", MAX_PAGE_SIZE);
+		return 1;
+	}
+
+	pageMap pages;
+	uint32_t lowest = 0xFFFFFFFF;
+	uint32_t highest = 0;
+	uint32_t dataBytes = 0;
+
+	if (!readHex(argv[arg], pageSize, pages, lowest, highest, dataBytes))
+		return 1;
+
+	if (highest > flashSize || pages.size() > 0xFFFF)
+	{
+		fprintf(stderr, "%s: will not fit into %u bytes of flash\n", argv[arg], flashSize);
+		return 1;
+	}
+
+	// page map entries and pages
+	std::vector<uint8_t> body;
+	for (pageMap::const_iterator i = pages.begin(); i != pages.end(); ++i)
+	{
+		put32(body, i->first);
+		put32(body, ~crc32Update(0xFFFFFFFF, &i->second[0], pageSize));
+		if (packed)
+		{
+			std::vector<uint8_t> data = packPage(i->second);
+			put32(body, data.size());
+			body.insert(body.end(), data.begin(), data.end());
+		}
+		else
+			body.insert(body.end(), i->second.begin(), i->second.end());
+	} // end of for each page
+
+	std::vector<uint8_t> header;
+	put32(header, packed ? PFWZ_MAGIC : PFW_MAGIC);
+	for (int i = 0; i < 3; i++)
+		header.push_back(sig[i]);
+	header.push_back(fuseMask);
+	header.insert(header.end(), fuses, fuses + 4);
+	put32(header, flashSize);
+	put16(header, pageSize);
+	put16(header, pages.size());
+	put32(header, lowest);
+	put32(header, highest);
+	put32(header, dataBytes);
+	put32(header, ~crc32Update(0xFFFFFFFF, body.empty() ? NULL : &body[0], body.size()));
+
+	FILE *out = fopen(argv[arg + 1], "wb");
+	if (!out)
+	{
+		perror(argv[arg + 1]);
+		return 1;
+	}
+
+	bool ok = fwrite(&header[0], 1, header.size(), out) == header.size() &&
+			  fwrite(body.empty() ? "" : (const char *)&body[0], 1, body.size(), out) == body.size();
+	if (fclose(out) != 0 || !ok)
+	{
+		perror(argv[arg + 1]);
+		return 1;
+	}
+
+	printf("%s: %u pages of %u bytes, %u data bytes, %u bytes of pages in the file\n",
+		   argv[arg + 1], (unsigned)pages.size(), pageSize, dataBytes, (unsigned)body.size());
+	return 0;
+} // end of main
@@ -0,0 +1,85 @@
+// Arduino.h - stand-in for the Arduino core in the native (host) build
+//
+// Just what the programmer uses: the AVR registers are plain variables,
+//  PROGMEM is ordinary memory, and time is the simulated clock of
+//  sim_transport.h, which only moves on in delay / delayMicroseconds and
+//  while bytes go to the target (and in yield, where the programmer waits
+//  on an interrupt). Timer 1 and 2 compare match A interrupts are raised as
+//  the clock passes them (see hal.cpp).
+
+#ifndef Arduino_h
+#define Arduino_h
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef uint8_t byte;
+typedef bool boolean;
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+
+#define bit(b) (1UL << (b))
+#define lowByte(w) ((uint8_t)((w)&0xFF))
+#define highByte(w) ((uint8_t)((w) >> 8))
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+template <class A, class B>
+inline auto min(A a, B b) -> decltype(a + b) { return a < b ? a : b; }
+template <class A, class B>
+inline auto max(A a, B b) -> decltype(a + b) { return a > b ? a : b; }
+
+// program memory is just memory
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(p) (*(const uint8_t *)(p))
+#define pgm_read_word(p) (*(const uint16_t *)(p))
+#define pgm_read_dword(p) (*(const uint32_t *)(p))
+#define memcpy_P memcpy
+#define memcmp_P memcmp
+
+class __FlashStringHelper;
+#define F(s) (reinterpret_cast<const __FlashStringHelper *>(s))
+
+// interrupt handlers are ordinary functions, hal.cpp calls them
+#define ISR(vector) extern "C" void vector(void)
+
+void noInterrupts();
+void interrupts();
+
+// registers
+extern volatile uint8_t PORTB, DDRB, PINB;
+extern volatile uint8_t PORTC, DDRC, PINC;
+extern volatile uint8_t PORTD, DDRD, PIND;
+extern volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+extern volatile uint16_t OCR1A, TCNT1;
+extern volatile uint8_t TCCR2A, TCCR2B, TIMSK2, OCR2A;
+
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define OCIE1A 1
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM21 1
+#define OCIE2A 1
+
+// pins by Arduino number, only remembered
+void pinMode(int pin, int mode);
+void digitalWrite(int pin, int value);
+int digitalRead(int pin);
+
+// simulated time
+void delay(unsigned long ms);
+void delayMicroseconds(unsigned int us);
+unsigned long millis();
+unsigned long micros();
+void yield();
+
+#endif
@@ -0,0 +1,50 @@
+// EEPROM.h - stand-in for the Arduino EEPROM library in the native (host)
+//  build, 1 KB (ATmega328P) held in memory, erased (0xFF) at start
+//
+// Writes take the chip's 3.4 mS, starting a write while the last one is
+//  still going waits for it; see hal.cpp, and host.h to keep the contents
+//  in a file between runs.
+
+#ifndef EEPROM_h
+#define EEPROM_h
+
+#include <stdint.h>
+#include <string.h>
+
+class EEPROMClass
+{
+public:
+	EEPROMClass() { memset(cells, 0xFF, sizeof cells); }
+
+	uint8_t read(int idx) const { return cells[idx]; }
+	void write(int idx, uint8_t val);
+	void update(int idx, uint8_t val)
+	{
+		if (cells[idx] != val)
+			write(idx, val);
+	}
+	uint16_t length() const { return sizeof cells; }
+
+	template <typename T>
+	T &get(int idx, T &t) const
+	{
+		memcpy(&t, cells + idx, sizeof t);
+		return t;
+	}
+
+	// byte by byte, only those that change (as the library does)
+	template <typename T>
+	const T &put(int idx, const T &t)
+	{
+		const uint8_t *p = (const uint8_t *)&t;
+		for (unsigned int i = 0; i < sizeof t; i++)
+			update(idx + i, p[i]);
+		return t;
+	}
+
+	uint8_t cells[1024];
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
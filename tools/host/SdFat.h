@@ -0,0 +1,80 @@
+// SdFat.h - stand-in for SdFat in the native (host) build
+//
+// The card is a directory on the host (hostSdRoot, see host.h), "/fw.hex"
+//  is hostSdRoot/fw.hex. Only the calls the programmer makes are here.
+//  Reads and writes take simulated time, as they would on the SPI bus.
+
+#ifndef SdFat_h
+#define SdFat_h
+
+#include <stdio.h>
+
+#include "Arduino.h"
+
+// open flags, as in SdFat
+#define O_READ 0x01
+#define O_WRITE 0x02
+#define O_RDWR (O_READ | O_WRITE)
+#define O_APPEND 0x04
+#define O_CREAT 0x10
+#define O_TRUNC 0x40
+
+#define SPI_FULL_SPEED 0
+#define SPI_HALF_SPEED 1
+
+class SdFile
+{
+public:
+	SdFile() : file(NULL) {}
+	~SdFile() { close(); }
+
+	bool open(const char *path, uint8_t oflag = O_READ);
+	bool close();
+	bool isOpen() const { return file != NULL; }
+	int read(void *buf, size_t nbyte);
+	int write(const void *buf, size_t nbyte);
+	bool seekSet(uint32_t pos);
+	uint32_t fileSize() const;
+	bool getModifyDateTime(uint16_t *pdate, uint16_t *ptime) const;
+
+private:
+	FILE *file;
+};
+
+class SdFat
+{
+public:
+	bool begin(uint8_t csPin = 10, uint8_t sckDivisor = SPI_FULL_SPEED);
+	bool exists(const char *path);
+	bool remove(const char *path);
+};
+
+// the little of SdFat's iostreams the log needs
+class ios
+{
+public:
+	typedef uint8_t openmode;
+	static const openmode app = 0x1;
+	static const openmode in = 0x2;
+	static const openmode out = 0x4;
+};
+
+class ofstream
+{
+public:
+	ofstream(const char *path, ios::openmode mode = ios::out);
+	~ofstream();
+
+	ofstream &operator<<(const char *s);
+	ofstream &operator<<(const __FlashStringHelper *s);
+	ofstream &operator<<(char c);
+	ofstream &operator<<(int n);
+	ofstream &operator<<(unsigned int n);
+	ofstream &operator<<(long n);
+	ofstream &operator<<(unsigned long n);
+
+private:
+	FILE *file;
+};
+
+#endif
@@ -0,0 +1,185 @@
+# bench - runs the native build over a corpus of firmware images and reports
+#  where each session's time goes
+#
+# Each case is a .hex image made here (the same bytes every run) and the
+#  chip it is for. The programmer (pio run -e native) gets a fresh card
+#  directory holding just that image and a blank simulated target, and
+#  prints a JSON breakdown of the session by phase: check, compare, erase,
+#  write, verify, fuses, with modelled time (us), host CPU time (cpuUs), ISP
+#  and SD traffic for each. See host_main.cpp.
+#
+# Each image goes on the card three ways: as fw.hex (case "m328p_32k"), and
+#  converted by hex2pfw to fw.pfw (".pfw") and to a compressed fw.pfw
+#  (".pfwz", hex2pfw -z 1). The .pfw legs report their time against the
+#  .hex one.
+#
+# run:  python tools/host/bench.py [--program P] [--hex2pfw H] [--out results.json] [--baseline old.json]
+#
+# Without --hex2pfw, tools/hex2pfw.cpp is built with g++ for the run.
+#
+# With --baseline the totals are compared case by case, and the run fails
+#  if a case got slower than --tolerance (percent) or stopped flashing.
+#
+# hex_bench.cpp (pio run -e native_hexbench) times the .hex decoder alone.
+
+import argparse
+import json
+import os
+import random
+import shutil
+import subprocess
+import sys
+import tempfile
+
+SEED = 1
+RECORD = 16  # data bytes per .hex line, as avr-objcopy writes them
+
+# name, device, [(start, length)] of data
+CASES = [
+    ("t45_small", "ATtiny45", [(0, 1500)]),
+    ("m328p_32k", "ATmega328P", [(0, 32768 - 512)]),
+    ("m328p_sparse", "ATmega328P", [(0, 256), (0x2000, 100), (0x4100, 40), (0x7000, 600)]),
+    ("m328p_boot", "ATmega328P", [(0x7E00, 500)]),
+    ("m2560_256k", "ATmega2560", [(0, 262144 - 1024)]),
+]
+
+# hex2pfw's -s / -f / -p for each device above
+DEVICES = {
+    "ATtiny45": ("1E9206", 4096, 64),
+    "ATmega328P": ("1E950F", 32768, 128),
+    "ATmega2560": ("1E9801", 262144, 256),
+}
+
+# suffix of the case name, hex2pfw options (None: fw.hex as it is)
+LEGS = [
+    ("", None),
+    (".pfw", []),
+    (".pfwz", ["-z", "1"]),
+]
+
+METRICS = ["us", "cpuUs", "spiBytes", "sdBytesRead"]
+
+
+def record(kind, addr, data):
+    body = [len(data), (addr >> 8) & 0xFF, addr & 0xFF, kind] + list(data)
+    return ":%s%02X\n" % ("".join("%02X" % b for b in body), -sum(body) & 0xFF)
+
+
+def hexImage(blocks, rand):
+    """ .hex text for random data in the given blocks, type 02 records past 64K """
+    lines = []
+    segment = 0
+    for start, length in blocks:
+        data = bytes(rand.randrange(256) for _ in range(length))
+        for offset in range(0, length, RECORD):
+            addr = start + offset
+            if addr >> 16 != segment:
+                segment = addr >> 16
+                lines.append(record(2, 0, [segment << 4, 0]))  # segment base, addr >> 4
+            lines.append(record(0, addr & 0xFFFF, data[offset:offset + RECORD]))
+    lines.append(record(1, 0, []))
+    return "".join(lines)
+
+
+def buildHex2pfw(here, directory):
+    """ compiles tools/hex2pfw.cpp into directory, returns the program """
+    program = os.path.join(directory, "hex2pfw")
+    subprocess.run(["g++", "-O2", "-o", program, os.path.join(here, "..", "hex2pfw.cpp")], check=True)
+    return program
+
+
+def runCase(program, hex2pfw, name, device, blocks, text, options):
+    """ one session with the image on the card as fw.hex, or as fw.pfw made
+        with these hex2pfw options """
+    card = tempfile.mkdtemp(prefix="bench_")
+    try:
+        hexFile = os.path.join(card, "fw.hex")
+        with open(hexFile, "w") as f:
+            f.write(text)
+        if options is not None:
+            signature, flashSize, pageSize = DEVICES[device]
+            subprocess.run([hex2pfw, "-s", signature, "-f", str(flashSize), "-p", str(pageSize)] + options +
+                           [hexFile, os.path.join(card, "fw.pfw")], check=True, stdout=subprocess.DEVNULL)
+            os.remove(hexFile)
+        out = subprocess.run([program, "-j", "-d", device, card], check=True,
+                             stdout=subprocess.PIPE, universal_newlines=True).stdout
+    finally:
+        shutil.rmtree(card)
+    result = json.loads(out.splitlines()[-1])
+    result["case"] = name
+    result["imageBytes"] = sum(length for _, length in blocks)
+    return result
+
+
+def compare(results, baseline, tolerance):
+    """ prints the change in each total, returns False if anything regressed """
+    old = {r["case"]: r for r in baseline}
+    good = True
+    for r in results:
+        b = old.get(r["case"])
+        if b is None:
+            print("%-19s new case" % r["case"])
+            continue
+        changes = []
+        for m in METRICS:
+            change = 100.0 * (r[m] - b[m]) / b[m] if b[m] else 0.0
+            changes.append("%s %+.1f%%" % (m, change))
+            if m != "cpuUs" and change > tolerance:  # host CPU time is too noisy to fail on
+                good = False
+        if b["ok"] and not r["ok"]:
+            changes.append("no longer flashes")
+            good = False
+        print("%-19s %s" % (r["case"], ", ".join(changes)))
+    return good
+
+
+def main(args):
+    here = os.path.dirname(os.path.abspath(sys.argv[0]))
+    parser = argparse.ArgumentParser(description="benchmark the programmer against simulated targets")
+    parser.add_argument("--program", default=os.path.join(here, "..", "..", ".pio", "build", "native", "program"))
+    parser.add_argument("--hex2pfw", help="hex2pfw program for the .pfw legs, default: build tools/hex2pfw.cpp")
+    parser.add_argument("--out", help="write the results here (JSON), default stdout")
+    parser.add_argument("--baseline", help="results of an earlier run to compare with")
+    parser.add_argument("--tolerance", type=float, default=1.0, help="percent slower that counts as a regression")
+    opts = parser.parse_args(args)
+
+    rand = random.Random(SEED)
+    results = []
+    tools = tempfile.mkdtemp(prefix="bench_tools_")
+    try:
+        hex2pfw = opts.hex2pfw or buildHex2pfw(here, tools)
+        for name, device, blocks in CASES:
+            text = hexImage(blocks, rand)  # the same image for every leg
+            for suffix, options in LEGS:
+                results.append(runCase(opts.program, hex2pfw, name + suffix, device, blocks, text, options))
+    finally:
+        shutil.rmtree(tools)
+
+    text = json.dumps(results, indent=1)
+    if opts.out:
+        with open(opts.out, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+    hexUs = {}
+    for r in results:
+        phases = " ".join("%s=%d" % (p, v["us"] // 1000) for p, v in r["phases"].items() if v["us"])
+        name, dot, suffix = r["case"].partition(".")
+        if not dot:
+            hexUs[name] = r["us"]
+            against = ""
+        else:
+            against = " (%+.1f%% vs .hex)" % (100.0 * (r["us"] - hexUs[name]) / hexUs[name])
+        sys.stderr.write("%-19s %-4s %8d ms%s  %s\n" % (r["case"], "ok" if r["ok"] else "FAIL", r["us"] // 1000,
+                                                       against, phases))
+
+    good = all(r["ok"] for r in results)
+    if opts.baseline:
+        with open(opts.baseline) as f:
+            good = compare(results, json.load(f), opts.tolerance) and good
+    return 0 if good else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main(sys.argv[1:]))
@@ -0,0 +1,182 @@
+// hal - the Arduino core stand-in for the native (host) build, see Arduino.h
+
+#include "Arduino.h"
+#include "EEPROM.h"
+
+#include <stdio.h>
+
+#include "host.h"
+#include "sim_transport.h"
+
+volatile uint8_t PORTB, DDRB, PINB;
+volatile uint8_t PORTC, DDRC, PINC;
+volatile uint8_t PORTD, DDRD, PIND;
+volatile uint8_t TCCR1A, TCCR1B, TIMSK1;
+volatile uint16_t OCR1A, TCNT1;
+volatile uint8_t TCCR2A, TCCR2B, TIMSK2, OCR2A;
+
+EEPROMClass EEPROM;
+const char *hostEepromFile = NULL;
+unsigned long hostEepromWrites = 0;
+
+// time the chip takes to write an EEPROM byte, uS
+const unsigned long HOST_EEPROM_WRITE_US = 3400;
+static unsigned long eepromBusyUntil;
+
+// Arduino pin levels, 0 .. 19 on the ATmega328P
+const int HOST_PINS = 20;
+static int pinLevels[HOST_PINS];
+
+static bool interruptsOn = true;
+
+unsigned long hostTimer2Matches = 0;
+
+// the programmer's LED timer and ISP queue timer, if it has them
+extern "C" void TIMER1_COMPA_vect(void) __attribute__((weak));
+extern "C" void TIMER2_COMPA_vect(void) __attribute__((weak));
+
+void pinMode(int pin, int mode)
+{
+	(void)pin;
+	(void)mode;
+} // end of pinMode
+
+void digitalWrite(int pin, int value)
+{
+	if (pin >= 0 && pin < HOST_PINS)
+		pinLevels[pin] = value;
+} // end of digitalWrite
+
+int digitalRead(int pin)
+{
+	return hostPinLevel(pin);
+} // end of digitalRead
+
+int hostPinLevel(int pin)
+{
+	return pin >= 0 && pin < HOST_PINS ? pinLevels[pin] : LOW;
+} // end of hostPinLevel
+
+void noInterrupts()
+{
+	interruptsOn = false;
+} // end of noInterrupts
+
+void interrupts()
+{
+	interruptsOn = true;
+} // end of interrupts
+
+// timers in CTC mode: compare match A every (OCRnA + 1) * prescale clocks,
+//  0 uS if stopped (or the programmer has no handler)
+static unsigned long nextCompare1, nextCompare2;
+
+static unsigned long timer1Period()
+{
+	static const unsigned int prescales[8] = {0, 1, 8, 64, 256, 1024, 0, 0};
+	const unsigned int prescale = prescales[TCCR1B & (bit(CS12) | bit(CS11) | bit(CS10))];
+	if (TIMER1_COMPA_vect == NULL || (TIMSK1 & bit(OCIE1A)) == 0)
+		return 0;
+	return (OCR1A + 1UL) * prescale / (F_CPU / 1000000UL);
+} // end of timer1Period
+
+// timer 2 has its own prescales; periods under 1 uS are rounded up
+static unsigned long timer2Period()
+{
+	static const unsigned int prescales[8] = {0, 1, 8, 32, 64, 128, 256, 1024};
+	const unsigned int prescale = prescales[TCCR2B & (bit(CS22) | bit(CS21) | bit(CS20))];
+	if (TIMER2_COMPA_vect == NULL || (TIMSK2 & bit(OCIE2A)) == 0 || prescale == 0)
+		return 0;
+	return max((OCR2A + 1UL) * prescale / (F_CPU / 1000000UL), 1UL);
+} // end of timer2Period
+
+// call handler for each compare match up to now, the handler may stop its
+//  timer (the ISP queue does when it runs dry)
+static void runTimer(unsigned long now, unsigned long (*period)(), unsigned long &nextCompare, void (*handler)())
+{
+	if (period() == 0)
+	{
+		nextCompare = 0;
+		return; // not running
+	}
+
+	if (nextCompare == 0)
+		nextCompare = now + period();
+	while (interruptsOn && now >= nextCompare && period() != 0)
+	{
+		handler();
+		if (hostPinWatch != NULL)
+			hostPinWatch(); // each edge the handler makes
+		nextCompare += period();
+	}
+} // end of runTimer
+
+static void timer2Match()
+{
+	hostTimer2Matches++;
+	TIMER2_COMPA_vect();
+} // end of timer2Match
+
+static void runTimers(unsigned long now)
+{
+	runTimer(now, timer1Period, nextCompare1, TIMER1_COMPA_vect);
+	runTimer(now, timer2Period, nextCompare2, timer2Match);
+} // end of runTimers
+
+void hostStartClock()
+{
+	hostClockHook = runTimers;
+} // end of hostStartClock
+
+void delay(unsigned long ms)
+{
+	hostAdvance(ms * 1000);
+} // end of delay
+
+void delayMicroseconds(unsigned int us)
+{
+	hostAdvance(us);
+} // end of delayMicroseconds
+
+unsigned long millis()
+{
+	return hostMicros / 1000;
+} // end of millis
+
+unsigned long micros()
+{
+	return hostMicros;
+} // end of micros
+
+// the programmer is waiting for an interrupt, let the clock run
+void yield()
+{
+	hostAdvance(1);
+} // end of yield
+
+void EEPROMClass::write(int idx, uint8_t val)
+{
+	if (hostMicros < eepromBusyUntil)
+		hostAdvance(eepromBusyUntil - hostMicros); // the library waits for the last write
+	cells[idx] = val;
+	eepromBusyUntil = hostMicros + HOST_EEPROM_WRITE_US;
+	hostEepromWrites++;
+
+	// written through, so it survives the run being cut short
+	FILE *file = hostEepromFile != NULL ? fopen(hostEepromFile, "wb") : NULL;
+	if (file != NULL)
+	{
+		fwrite(cells, 1, sizeof cells, file);
+		fclose(file);
+	}
+} // end of EEPROMClass::write
+
+void hostLoadEeprom()
+{
+	FILE *file = hostEepromFile != NULL ? fopen(hostEepromFile, "rb") : NULL;
+	if (file == NULL)
+		return; // still erased
+	if (fread(EEPROM.cells, 1, sizeof EEPROM.cells, file) != sizeof EEPROM.cells)
+		memset(EEPROM.cells, 0xFF, sizeof EEPROM.cells);
+	fclose(file);
+} // end of hostLoadEeprom
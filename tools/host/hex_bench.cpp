@@ -0,0 +1,252 @@
+// hex_bench - .hex decoding speed on the host, lines per second: the table
+//  decoder the programmer uses (decodeHexChunk, processRecord) against the
+//  isxdigit / hexConv line decoder it replaced
+//
+// usage: hex_bench [-l lines] [-r rounds]
+//
+// Built like the native program (-D ISP_TRANSPORT=3) but without
+//  host_main.cpp. The image is random data in 16 byte records, as
+//  avr-objcopy writes them (bench.py's corpus), already in memory: only the
+//  decoding is timed, not the card. The old decoder gets each line copied
+//  out first, as ifstream::getline gave it them; the table decoder gets the
+//  text in HEX_CHUNK_SIZE pieces, as parseHexFile reads it. Both hand each
+//  record to the same processRecord, with the page image off, so what
+//  differs is the character to byte conversion and the sumcheck. Each round times both,
+//  the fastest round of each is reported.
+//
+// The host is not the board: glibc's isxdigit is an inline table lookup
+//  where avr-libc's is a call, so the old decoder does better here than it
+//  would there.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "Arduino.h"
+
+// the programmer's decoder and the state it keeps (src/main.cpp)
+bool decodeHexChunk(const byte *chunk, const int count, const byte action);
+bool processRecord(const byte action);
+extern byte hexBuffer[];
+extern int bytesInLine;
+extern byte sumCheck;
+extern unsigned int lineCount;
+extern unsigned long extendedAddress;
+extern bool gotEndOfFile;
+extern bool imageOk;
+
+const byte CHECK_FILE = 0; // checkFile, the pass that decodes the whole file
+const byte RECORD = 16;	   // data bytes per .hex line
+const int HEX_CHUNK_SIZE = 64; // parseHexFile's read size
+const int OLD_MAX_HEX_DATA = 40;
+const int OLD_MAX_LINE = 80;
+
+// called by the programmer's startPhase; phases are host_main.cpp's business
+void hostPhase(uint8_t)
+{
+} // end of hostPhase
+
+// convert two hex characters into a byte (as the programmer had it)
+//    returns true if error, false if OK
+static bool hexConv(const char *(&pStr), byte &b)
+{
+	if (!isxdigit(pStr[0]) || !isxdigit(pStr[1]))
+		return true;
+
+	b = *pStr++ - '0';
+	if (b > 9)
+		b -= 7;
+
+	// high-order nybble
+	b <<= 4;
+
+	byte b1 = *pStr++ - '0';
+	if (b1 > 9)
+		b1 -= 7;
+
+	b |= b1;
+
+	return false; // OK
+} // end of hexConv
+
+// one line at a time, as processLine decoded them before the table
+// returns true if error, false if OK
+static bool oldProcessLine(const char *pLine, const byte action)
+{
+	if (*pLine++ != ':')
+		return true;
+
+	bytesInLine = 0;
+
+	// convert entire line from ASCII into binary
+	while (isxdigit(*pLine))
+	{
+		// can't fit?
+		if (bytesInLine >= OLD_MAX_HEX_DATA)
+			return true;
+
+		if (hexConv(pLine, hexBuffer[bytesInLine++]))
+			return true;
+	} // end of while
+
+	if (bytesInLine < 5)
+		return true;
+
+	// sumcheck it
+	byte sum = 0;
+	for (int i = 0; i < (bytesInLine - 1); i++)
+		sum += hexBuffer[i];
+
+	// 2's complement
+	sum = ~sum + 1;
+
+	if (sum != hexBuffer[bytesInLine - 1])
+		return true;
+
+	sumCheck = 0; // checked, processRecord need not look again
+	return processRecord(action);
+} // end of oldProcessLine
+
+// copy the line starting at text[i] into "line" without its ending, as
+//  ifstream::getline did for the old parseHexFile; i is left on the ending
+// returns true if error (too long), false if OK
+static bool oldGetLine(const std::string &text, size_t &i, char *line)
+{
+	int count = 0;
+	while (i < text.size() && text[i] != '\n')
+	{
+		if (count >= OLD_MAX_LINE - 1)
+			return true;
+		line[count++] = text[i++];
+	}
+	line[count] = 0;
+	return false;
+} // end of oldGetLine
+
+static void startFile()
+{
+	lineCount = 0;
+	extendedAddress = 0;
+	gotEndOfFile = false;
+	imageOk = false; // no page image, decoding only
+} // end of startFile
+
+static double seconds()
+{
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec / 1e9;
+} // end of seconds
+
+static void addRecord(std::string &text, byte kind, unsigned int addr, const byte *data, byte length)
+{
+	char digits[3];
+	byte sum = length + (addr >> 8) + addr + kind;
+	snprintf(digits, sizeof digits, "%02X", length);
+	text += ':';
+	text += digits;
+	snprintf(digits, sizeof digits, "%02X", (addr >> 8) & 0xFF);
+	text += digits;
+	snprintf(digits, sizeof digits, "%02X", addr & 0xFF);
+	text += digits;
+	snprintf(digits, sizeof digits, "%02X", kind);
+	text += digits;
+	for (byte i = 0; i < length; i++)
+	{
+		snprintf(digits, sizeof digits, "%02X", data[i]);
+		text += digits;
+		sum += data[i];
+	}
+	snprintf(digits, sizeof digits, "%02X", (byte)-sum);
+	text += digits;
+	text += '\n';
+} // end of addRecord
+
+int main(int argc, char **argv)
+{
+	unsigned long lines = 16320; // an ATmega2560's flash, less the boot loader
+	unsigned int rounds = 20;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "l:r:")) != -1)
+		switch (opt)
+		{
+		case 'l':
+			lines = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			rounds = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-l lines] [-r rounds]\n", argv[0]);
+			return 2;
+		} // end of switch on option
+
+	if (lines == 0 || rounds == 0)
+	{
+		fprintf(stderr, "%s: nothing to time\n", argv[0]);
+		return 2;
+	}
+
+	// the image, with a type 02 record at each 64K
+	std::string text;
+	uint32_t seed = 1;
+	byte data[RECORD];
+	for (unsigned long line = 0; line < lines; line++)
+	{
+		const unsigned long addr = line * RECORD;
+		if (addr % 0x10000 == 0 && addr > 0)
+		{
+			const byte segment[2] = {(byte)((addr >> 16) << 4), 0}; // segment base, addr >> 4
+			addRecord(text, 2, 0, segment, 2);
+		}
+		for (byte i = 0; i < RECORD; i++)
+			data[i] = (seed = seed * 1103515245 + 12345) >> 16;
+		addRecord(text, 0, addr & 0xFFFF, data, RECORD);
+	} // end of for each line
+	addRecord(text, 1, 0, NULL, 0);
+
+	char line[OLD_MAX_LINE];
+	double oldBest = 0;
+	double newBest = 0;
+	bool failed = false;
+
+	for (unsigned int round = 0; round < rounds && !failed; round++)
+	{
+		startFile();
+		double start = seconds();
+		for (size_t i = 0; i < text.size() && !failed; i++)
+			failed = oldGetLine(text, i, line) || oldProcessLine(line, CHECK_FILE);
+		double took = seconds() - start;
+		failed = failed || !gotEndOfFile;
+		if (round == 0 || took < oldBest)
+			oldBest = took;
+
+		startFile();
+		start = seconds();
+		for (size_t i = 0; i < text.size() && !failed; i += HEX_CHUNK_SIZE)
+			failed = decodeHexChunk((const byte *)text.data() + i, min(text.size() - i, (size_t)HEX_CHUNK_SIZE), CHECK_FILE);
+		took = seconds() - start;
+		failed = failed || !gotEndOfFile;
+		if (round == 0 || took < newBest)
+			newBest = took;
+	} // end of for each round
+
+	if (failed)
+	{
+		fprintf(stderr, "%s: the image did not decode\n", argv[0]);
+		return 1;
+	}
+
+	const double records = lineCount;
+	printf("lines=%.0f rounds=%u\n", records, rounds);
+	printf("isxdigit/hexConv  %12.0f lines/s\n", records / oldBest);
+	printf("table             %12.0f lines/s  (%+.1f%%)\n", records / newBest,
+		   (oldBest / newBest - 1) * 100);
+	return 0;
+} // end of main
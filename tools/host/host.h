@@ -0,0 +1,35 @@
+// host.h - what the native build's stand-ins (hal.cpp, sdfat.cpp) let the
+//  host side see and set
+
+#ifndef host_h
+#define host_h
+
+// SD card transfer time, uS per byte (SdFat moves whole 512 byte blocks
+//  with SPI at F_CPU / 2, plus the command and copy overhead)
+const unsigned int HOST_SD_US_PER_BYTE = 3;
+
+// directory that stands in for the card, "/fw.hex" is hostSdRoot/fw.hex
+extern const char *hostSdRoot;
+
+// card traffic since start
+extern unsigned long hostSdBytesRead;
+extern unsigned long hostSdBytesWritten;
+
+// last level written to an Arduino pin, LOW if never written
+int hostPinLevel(int pin);
+
+// connect the stand-in timer to the simulated clock
+void hostStartClock();
+
+// file that keeps the programmer's EEPROM between runs, NULL for none;
+//  hostLoadEeprom reads it, every write saves it
+extern const char *hostEepromFile;
+void hostLoadEeprom();
+
+// EEPROM bytes written since start
+extern unsigned long hostEepromWrites;
+
+// timer 2 compare match interrupts (the ISP queue's clock edges) since start
+extern unsigned long hostTimer2Matches;
+
+#endif
@@ -0,0 +1,302 @@
+// host_main - runs the programmer in the native build, against a simulated
+//  target (sim_target.h) and a directory standing in for the SD card
+//
+// usage: program [-d device] [-c target clock Hz] [-n sessions] [-t targets] [-x dead target]
+//                [-e EEPROM file] [-f target file] [-b brown out uS] [-j] [card directory]
+//
+// device is a name from devices.h (default ATmega328P). Each session is one
+//  pass of loop(), as when a target is put on the board; a line of
+//  key=value figures is printed for it (-j: a JSON object, with a breakdown
+//  by phase), the programmer's own summary goes to fw.log on the card as
+//  usual.
+//
+// -t puts that many of the device on the header (default GANG_TARGETS, so
+//  1 unless the programmer is a gang build); the target figures are target
+//  0's. -x gives target n a flash byte that will not program (address 0),
+//  so it fails verification and should drop out of a gang session.
+//
+// -e keeps the programmer's EEPROM in a file, -f the targets' flash and
+//  fuses, from one run to the next. -b cuts the power that many uS into
+//  the run (simulated time): a "brownout" line is printed, the files are
+//  saved as they stand and the program stops, so the next run can be
+//  checked for carrying on where this one left off.
+//
+// Time is the simulated clock, what the session would take on the board;
+//  cpuUs is what the host spent, which follows the programmer's own code
+//  (parsing in the check phase, mostly) rather than the ISP and SD traffic.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "host.h"
+#include "sim_transport.h"
+
+#ifndef GANG_TARGETS
+#define GANG_TARGETS 1
+#endif
+
+// the programmer (src/main.cpp)
+void setup();
+void loop();
+extern volatile uint8_t ledMessage; // last status message shown
+
+// same order as the phase enum in src/main.cpp, "other" is between phases
+//  (entering programming mode, signature, log)
+const char *const phaseNames[] = {"check", "compare", "erase", "write", "verify", "fuses", "other"};
+const uint8_t PHASES = sizeof phaseNames / sizeof phaseNames[0];
+const uint8_t OTHER = PHASES - 1;
+
+typedef struct
+{
+	unsigned long us;
+	unsigned long cpuUs;
+	unsigned long spiBytes;
+	unsigned long sdBytesRead;
+} phaseStatsType;
+
+static phaseStatsType phaseStats[PHASES];
+static unsigned long sessionNumber;
+static uint8_t phase = OTHER;
+static phaseStatsType phaseStart;
+
+static unsigned long cpuMicros()
+{
+	struct timespec t;
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+	return t.tv_sec * 1000000UL + t.tv_nsec / 1000;
+} // end of cpuMicros
+
+static phaseStatsType snapshot()
+{
+	phaseStatsType s;
+	s.us = hostMicros;
+	s.cpuUs = cpuMicros();
+	s.spiBytes = simTargets[0]->stats.spiBytes;
+	s.sdBytesRead = hostSdBytesRead;
+	return s;
+} // end of snapshot
+
+// called by the programmer's startPhase
+void hostPhase(uint8_t which)
+{
+	const phaseStatsType now = snapshot();
+	phaseStatsType &p = phaseStats[phase];
+	p.us += now.us - phaseStart.us;
+	p.cpuUs += now.cpuUs - phaseStart.cpuUs;
+	p.spiBytes += now.spiBytes - phaseStart.spiBytes;
+	p.sdBytesRead += now.sdBytesRead - phaseStart.sdBytesRead;
+
+	phase = which < OTHER ? which : OTHER;
+	phaseStart = now;
+} // end of hostPhase
+
+// "OK" or "FAILED" from the last line the programmer added to fw.log
+static bool sessionOk()
+{
+	char name[512];
+	snprintf(name, sizeof name, "%s/fw.log", hostSdRoot);
+	FILE *log = fopen(name, "r");
+	if (log == NULL)
+		return false;
+
+	char line[256], last[256] = "";
+	while (fgets(line, sizeof line, log) != NULL)
+		strcpy(last, line);
+	fclose(log);
+	return strncmp(last, "OK", 2) == 0;
+} // end of sessionOk
+
+// the targets' flash then fuses, one after the other, in "name"
+static std::vector<SimTarget> *savedTargets;
+static const char *targetFile = NULL;
+
+static void loadTargets()
+{
+	FILE *file = targetFile != NULL ? fopen(targetFile, "rb") : NULL;
+	if (file == NULL)
+		return; // blank chips
+	for (SimTarget &target : *savedTargets)
+		if (fread(target.flash.data(), 1, target.flash.size(), file) != target.flash.size() ||
+			fread(target.fuses, 1, sizeof target.fuses, file) != sizeof target.fuses)
+			fprintf(stderr, "%s: short, for another device?\n", targetFile);
+	fclose(file);
+} // end of loadTargets
+
+static void saveTargets()
+{
+	FILE *file = targetFile != NULL ? fopen(targetFile, "wb") : NULL;
+	if (file == NULL)
+		return;
+	for (SimTarget &target : *savedTargets)
+	{
+		fwrite(target.flash.data(), 1, target.flash.size(), file);
+		fwrite(target.fuses, 1, sizeof target.fuses, file);
+	}
+	fclose(file);
+} // end of saveTargets
+
+// clock hook for -b, after the timers' own
+static unsigned long brownOutAt = 0;
+static void (*timerHook)(unsigned long now);
+
+static void brownOut(unsigned long now)
+{
+	timerHook(now);
+	if (now < brownOutAt)
+		return;
+
+	saveTargets(); // the EEPROM file is written as it goes
+	printf("session=%lu brownout us=%lu\n", sessionNumber, now);
+	exit(0);
+} // end of brownOut
+
+static void printJson(unsigned long session, const simDeviceType &device, const phaseStatsType &total,
+					  const simStatsType &target, unsigned long eepromWrites)
+{
+	printf("{\"session\": %lu, \"device\": \"%s\", \"ok\": %s, \"message\": %u, \"us\": %lu, \"cpuUs\": %lu,"
+		   " \"spiBytes\": %lu, \"sdBytesRead\": %lu, \"pages\": %lu, \"erases\": %lu, \"fuseWrites\": %lu,"
+		   " \"polls\": %lu, \"busyPolls\": %lu, \"resets\": %lu, \"eepromWrites\": %lu, \"phases\": {",
+		   session, device.name, sessionOk() ? "true" : "false", (unsigned)ledMessage, total.us, total.cpuUs,
+		   total.spiBytes, total.sdBytesRead, target.pagesCommitted, target.erases, target.fuseWrites,
+		   target.polls, target.busyPolls, target.resets, eepromWrites);
+	for (uint8_t i = 0; i < PHASES; i++)
+		printf("%s\"%s\": {\"us\": %lu, \"cpuUs\": %lu, \"spiBytes\": %lu, \"sdBytesRead\": %lu}",
+			   i ? ", " : "", phaseNames[i], phaseStats[i].us, phaseStats[i].cpuUs, phaseStats[i].spiBytes,
+			   phaseStats[i].sdBytesRead);
+	printf("}}\n");
+} // end of printJson
+
+int main(int argc, char **argv)
+{
+	const char *deviceName = "ATmega328P";
+	unsigned long targetClock = 1000000;
+	unsigned long sessions = 1;
+	unsigned long targets = GANG_TARGETS;
+	long deadTarget = -1;
+	bool json = false;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "d:c:n:t:x:e:f:b:j")) != -1)
+		switch (opt)
+		{
+		case 'd':
+			deviceName = optarg;
+			break;
+		case 'c':
+			targetClock = strtoul(optarg, NULL, 0);
+			break;
+		case 'n':
+			sessions = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			targets = strtoul(optarg, NULL, 0);
+			break;
+		case 'x':
+			deadTarget = strtol(optarg, NULL, 0);
+			break;
+		case 'e':
+			hostEepromFile = optarg;
+			break;
+		case 'f':
+			targetFile = optarg;
+			break;
+		case 'b':
+			brownOutAt = strtoul(optarg, NULL, 0);
+			break;
+		case 'j':
+			json = true;
+			break;
+		default:
+			fprintf(stderr,
+					"usage: %s [-d device] [-c target clock Hz] [-n sessions] [-t targets] [-x dead target]"
+					" [-e EEPROM file] [-f target file] [-b brown out uS] [-j] [card directory]\n",
+					argv[0]);
+			return 2;
+		} // end of switch on option
+	if (optind < argc)
+		hostSdRoot = argv[optind];
+
+	const simDeviceType *device = findSimDevice(deviceName);
+	if (device == NULL)
+	{
+		fprintf(stderr, "%s: unknown device %s\n", argv[0], deviceName);
+		return 2;
+	}
+
+	if (targets < 1 || targets > HOST_MAX_TARGETS)
+	{
+		fprintf(stderr, "%s: 1 to %u targets\n", argv[0], (unsigned)HOST_MAX_TARGETS);
+		return 2;
+	}
+
+	std::vector<SimTarget> fitted(targets, SimTarget(*device, targetClock));
+	for (unsigned long t = 0; t < targets; t++)
+		simTargets[t] = &fitted[t];
+	if (deadTarget >= 0 && (unsigned long)deadTarget < targets)
+		fitted[deadTarget].deadByte = 0;
+	SimTarget &target = fitted[0];
+	savedTargets = &fitted;
+	loadTargets();
+	hostLoadEeprom();
+
+#if GANG_TARGETS > 1
+	hostAttachReset(&PORTC, &DDRC, 5); // BB_Board::Reset_Pin, gang wiring
+#else
+	hostAttachReset(&PORTD, &DDRD, 3); // BB_Board::Reset_Pin
+#endif
+	hostStartClock();
+	if (brownOutAt > 0)
+	{
+		timerHook = hostClockHook;
+		hostClockHook = brownOut;
+	}
+
+	setup();
+
+	for (unsigned long session = 1; session <= sessions; session++)
+	{
+		sessionNumber = session;
+		const simStatsType before = target.stats;
+		const unsigned long eepromBefore = hostEepromWrites;
+		memset(phaseStats, 0, sizeof phaseStats);
+		phase = OTHER;
+		phaseStart = snapshot();
+		const phaseStatsType start = phaseStart;
+
+		loop();
+
+		hostPhase(OTHER); // close the last phase
+		const phaseStatsType end = snapshot();
+		phaseStatsType total;
+		total.us = end.us - start.us;
+		total.cpuUs = end.cpuUs - start.cpuUs;
+		total.spiBytes = end.spiBytes - start.spiBytes;
+		total.sdBytesRead = end.sdBytesRead - start.sdBytesRead;
+
+		simStatsType delta = target.stats;
+		delta.pagesCommitted -= before.pagesCommitted;
+		delta.erases -= before.erases;
+		delta.fuseWrites -= before.fuseWrites;
+		delta.polls -= before.polls;
+		delta.busyPolls -= before.busyPolls;
+		delta.resets -= before.resets;
+
+		if (json)
+			printJson(session, *device, total, delta, hostEepromWrites - eepromBefore);
+		else
+			printf("session=%lu device=%s us=%lu spiBytes=%lu sdBytesRead=%lu pages=%lu erases=%lu"
+				   " fuseWrites=%lu polls=%lu resets=%lu eepromWrites=%lu message=%u\n",
+				   session, device->name, total.us, total.spiBytes, total.sdBytesRead, delta.pagesCommitted,
+				   delta.erases, delta.fuseWrites, delta.polls, delta.resets, hostEepromWrites - eepromBefore,
+				   (unsigned)ledMessage);
+	} // end of for each session
+
+	saveTargets();
+
+	return 0;
+} // end of main
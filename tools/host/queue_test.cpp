@@ -0,0 +1,188 @@
+// queue_test - flashes a simulated target over the bit banged transport at
+//  a slow speed level, so the ISP queue's timer 2 interrupt clocks it
+//
+// usage: queue_test [-d device] [-c target clock Hz] [-b image bytes]
+//
+// Built with -D ISP_TRANSPORT=0 (ISP_BITBANG), without host_main.cpp. The
+//  native build proper uses ISP_HOST, which sends every instruction
+//  straight away; here the target is clocked pin by pin from the SCK, MOSI
+//  and MISO bits of PORTD / PIND, whether the programmer's own loop or the
+//  interrupt drives them. The default target clock (128 kHz, the internal
+//  oscillator) keeps speed negotiation at levels where bbDelay is at least
+//  ISP_QUEUE_MIN_DELAY.
+//
+// The session has to finish OK (fw.log), the target's flash has to hold
+//  the image, and the interrupt has to have run; the exit status is 0 if so.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Arduino.h"
+#include "host.h"
+#include "sim_transport.h"
+
+// the programmer (src/main.cpp)
+void setup();
+void loop();
+
+// BB_Board wiring, single target
+const uint8_t SCK_BIT = 2;
+const uint8_t MOSI_BIT = 1;
+const uint8_t MISO_BIT = 0;
+const uint8_t RESET_BIT = 3;
+
+const uint8_t RECORD = 16; // data bytes per .hex line
+
+static SimTarget *target;
+static bool sckWas;
+static bool resetWas;
+static uint8_t bitsIn; // of the byte coming in
+static uint8_t byteIn;
+static uint8_t byteOut; // the target is sending
+
+// hostPinWatch: a rising SCK edge samples MOSI, the 8th hands the byte to
+//  the target; while SCK is low MISO shows the bit to be read next
+static void watchPins()
+{
+	const bool reset = PORTD & bit(RESET_BIT);
+	if (reset != resetWas)
+		bitsIn = 0; // frames start over
+	resetWas = reset;
+
+	const bool sck = (DDRD & bit(SCK_BIT)) && (PORTD & bit(SCK_BIT));
+	if (sck && !sckWas)
+	{
+		byteIn = (byteIn << 1) | ((PORTD >> MOSI_BIT) & 1);
+		if (++bitsIn == 8)
+		{
+			target->transfer(byteIn, hostSCK(), hostMicros);
+			bitsIn = 0;
+		}
+	} // end of rising edge
+	sckWas = sck;
+
+	if (!sck)
+	{
+		if (bitsIn == 0)
+			byteOut = target->sends(hostSCK());
+		if ((byteOut << bitsIn) & 0x80)
+			PIND |= bit(MISO_BIT);
+		else
+			PIND &= ~bit(MISO_BIT);
+	} // end of clock low
+} // end of watchPins
+
+static void writeRecord(FILE *hex, uint8_t kind, unsigned int addr, const uint8_t *data, uint8_t length)
+{
+	uint8_t sum = length + (addr >> 8) + addr + kind;
+	fprintf(hex, ":%02X%04X%02X", length, addr & 0xFFFF, kind);
+	for (uint8_t i = 0; i < length; i++)
+	{
+		fprintf(hex, "%02X", data[i]);
+		sum += data[i];
+	}
+	fprintf(hex, "%02X\n", (uint8_t)-sum);
+} // end of writeRecord
+
+// "last" gets the last line of fw.log
+static bool lastLogLine(char *last, size_t size)
+{
+	char name[512];
+	snprintf(name, sizeof name, "%s/fw.log", hostSdRoot);
+	FILE *log = fopen(name, "r");
+	if (log == NULL)
+		return false;
+
+	char line[512];
+	*last = 0;
+	while (fgets(line, sizeof line, log) != NULL)
+		snprintf(last, size, "%s", line);
+	fclose(log);
+	return true;
+} // end of lastLogLine
+
+int main(int argc, char **argv)
+{
+	const char *deviceName = "ATmega328P";
+	unsigned long targetClock = 128000;
+	unsigned long imageBytes = 2000;
+
+	int opt;
+	while ((opt = getopt(argc, argv, "d:c:b:")) != -1)
+		switch (opt)
+		{
+		case 'd':
+			deviceName = optarg;
+			break;
+		case 'c':
+			targetClock = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			imageBytes = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "usage: %s [-d device] [-c target clock Hz] [-b image bytes]\n", argv[0]);
+			return 2;
+		} // end of switch on option
+
+	const simDeviceType *device = findSimDevice(deviceName);
+	if (device == NULL || imageBytes == 0 || imageBytes > device->flashSize || imageBytes > 0x10000)
+	{
+		fprintf(stderr, "%s: unknown device, or the image does not fit\n", argv[0]);
+		return 2;
+	}
+
+	// the card, with an image of the same bytes every run
+	char card[] = "/tmp/queue_test_XXXXXX";
+	if (mkdtemp(card) == NULL)
+	{
+		perror(argv[0]);
+		return 2;
+	}
+	hostSdRoot = card;
+
+	std::vector<uint8_t> image(imageBytes);
+	uint32_t seed = 1;
+	for (uint8_t &b : image)
+		b = (seed = seed * 1103515245 + 12345) >> 16;
+
+	char name[512];
+	snprintf(name, sizeof name, "%s/fw.hex", card);
+	FILE *hex = fopen(name, "w");
+	for (unsigned long addr = 0; addr < imageBytes; addr += RECORD)
+		writeRecord(hex, 0, addr, &image[addr], min(imageBytes - addr, (unsigned long)RECORD));
+	writeRecord(hex, 1, 0, NULL, 0);
+	fclose(hex);
+
+	SimTarget sim(*device, targetClock);
+	target = &sim;
+	simTargets[0] = &sim;
+
+	hostAttachReset(&PORTD, &DDRD, RESET_BIT);
+	hostPinWatch = watchPins;
+	hostStartClock();
+
+	setup();
+	loop();
+
+	char last[512] = "";
+	const bool logged = lastLogLine(last, sizeof last);
+	const bool ok = logged && strncmp(last, "OK", 2) == 0;
+	const bool flashed = memcmp(sim.flash.data(), image.data(), imageBytes) == 0;
+	const bool queued = hostTimer2Matches > 0;
+
+	printf("device=%s targetClock=%lu us=%lu timer2Matches=%lu frames=%lu badBytes=%lu session=%s flash=%s\n",
+		   device->name, targetClock, hostMicros, hostTimer2Matches, sim.stats.frames, sim.stats.badBytes,
+		   ok ? "OK" : "FAILED", flashed ? "OK" : "WRONG");
+	if (!ok)
+		printf("fw.log: %s", logged ? last : "missing\n");
+
+	snprintf(name, sizeof name, "rm -rf %s", card);
+	if (system(name) != 0)
+		fprintf(stderr, "%s: could not remove %s\n", argv[0], card);
+
+	return ok && flashed && queued ? 0 : 1;
+} // end of main
@@ -0,0 +1,170 @@
+// sdfat - the SdFat stand-in for the native (host) build, see SdFat.h
+
+#include "SdFat.h"
+
+#include <string>
+#include <sys/stat.h>
+#include <time.h>
+
+#include "host.h"
+#include "sim_transport.h"
+
+const char *hostSdRoot = ".";
+unsigned long hostSdBytesRead = 0;
+unsigned long hostSdBytesWritten = 0;
+
+// card path to host path
+static std::string hostPath(const char *path)
+{
+	std::string full(hostSdRoot);
+	if (*path != '/')
+		full += '/';
+	return full + path;
+} // end of hostPath
+
+bool SdFile::open(const char *path, uint8_t oflag)
+{
+	close();
+
+	const std::string name = hostPath(path);
+	if ((oflag & O_WRITE) == 0)
+		file = fopen(name.c_str(), "rb");
+	else if (oflag & O_TRUNC)
+		file = fopen(name.c_str(), "w+b");
+	else
+	{
+		file = fopen(name.c_str(), oflag & O_READ ? "r+b" : "ab");
+		if (file == NULL && (oflag & O_CREAT))
+			file = fopen(name.c_str(), "w+b");
+	}
+	return file != NULL;
+} // end of SdFile::open
+
+bool SdFile::close()
+{
+	if (file == NULL)
+		return false;
+	fclose(file);
+	file = NULL;
+	return true;
+} // end of SdFile::close
+
+int SdFile::read(void *buf, size_t nbyte)
+{
+	if (file == NULL)
+		return -1;
+	const size_t count = fread(buf, 1, nbyte, file);
+	hostSdBytesRead += count;
+	hostAdvance(count * HOST_SD_US_PER_BYTE);
+	return (int)count;
+} // end of SdFile::read
+
+int SdFile::write(const void *buf, size_t nbyte)
+{
+	if (file == NULL)
+		return -1;
+	const size_t count = fwrite(buf, 1, nbyte, file);
+	hostSdBytesWritten += count;
+	hostAdvance(count * HOST_SD_US_PER_BYTE);
+	return count == nbyte ? (int)count : -1;
+} // end of SdFile::write
+
+bool SdFile::seekSet(uint32_t pos)
+{
+	return file != NULL && fseek(file, pos, SEEK_SET) == 0;
+} // end of SdFile::seekSet
+
+uint32_t SdFile::fileSize() const
+{
+	struct stat info;
+	return file != NULL && fstat(fileno(file), &info) == 0 ? (uint32_t)info.st_size : 0;
+} // end of SdFile::fileSize
+
+// FAT format: date is year - 1980, month, day in 7, 4, 5 bits, time is
+//  hours, minutes, seconds / 2 in 5, 6, 5 bits
+bool SdFile::getModifyDateTime(uint16_t *pdate, uint16_t *ptime) const
+{
+	struct stat info;
+	if (file == NULL || fstat(fileno(file), &info) != 0)
+		return false;
+
+	struct tm when;
+	localtime_r(&info.st_mtime, &when);
+	*pdate = (when.tm_year - 80) << 9 | (when.tm_mon + 1) << 5 | when.tm_mday;
+	*ptime = when.tm_hour << 11 | when.tm_min << 5 | when.tm_sec / 2;
+	return true;
+} // end of SdFile::getModifyDateTime
+
+bool SdFat::begin(uint8_t csPin, uint8_t sckDivisor)
+{
+	(void)csPin;
+	(void)sckDivisor;
+	return exists("/");
+} // end of SdFat::begin
+
+bool SdFat::exists(const char *path)
+{
+	struct stat info;
+	return stat(hostPath(path).c_str(), &info) == 0;
+} // end of SdFat::exists
+
+bool SdFat::remove(const char *path)
+{
+	return ::remove(hostPath(path).c_str()) == 0;
+} // end of SdFat::remove
+
+ofstream::ofstream(const char *path, ios::openmode mode)
+{
+	file = fopen(hostPath(path).c_str(), mode & ios::app ? "ab" : "wb");
+} // end of ofstream::ofstream
+
+ofstream::~ofstream()
+{
+	if (file != NULL)
+		fclose(file);
+} // end of ofstream::~ofstream
+
+ofstream &ofstream::operator<<(const char *s)
+{
+	if (file != NULL)
+	{
+		hostSdBytesWritten += fputs(s, file) >= 0 ? strlen(s) : 0;
+		hostAdvance(strlen(s) * HOST_SD_US_PER_BYTE);
+	}
+	return *this;
+} // end of ofstream::operator<<
+
+ofstream &ofstream::operator<<(const __FlashStringHelper *s)
+{
+	return *this << reinterpret_cast<const char *>(s);
+} // end of ofstream::operator<<
+
+ofstream &ofstream::operator<<(char c)
+{
+	const char s[2] = {c, 0};
+	return *this << s;
+} // end of ofstream::operator<<
+
+ofstream &ofstream::operator<<(int n)
+{
+	return *this << (long)n;
+} // end of ofstream::operator<<
+
+ofstream &ofstream::operator<<(unsigned int n)
+{
+	return *this << (unsigned long)n;
+} // end of ofstream::operator<<
+
+ofstream &ofstream::operator<<(long n)
+{
+	char s[24];
+	snprintf(s, sizeof s, "%ld", n);
+	return *this << s;
+} // end of ofstream::operator<<
+
+ofstream &ofstream::operator<<(unsigned long n)
+{
+	char s[24];
+	snprintf(s, sizeof s, "%lu", n);
+	return *this << s;
+} // end of ofstream::operator<<
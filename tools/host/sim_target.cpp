@@ -0,0 +1,292 @@
+// sim_target - a simulated AVR in serial programming mode, see sim_target.h
+
+#include "sim_target.h"
+
+#include <string.h>
+
+#include "devices.h"
+
+#define SIM_DEVICE(id, sig0, sig1, sig2, name, flashSize, eepromSize, pageSize, eepromPageSize, bootSize, \
+				   bootFuse, fuseMask, timedWrites, tWDFlash, tWDErase, tWDFuse, tReset)               \
+	{{sig0, sig1, sig2}, name, flashSize, eepromSize, pageSize, eepromPageSize, bootSize,                 \
+	 bootFuse, fuseMask, timedWrites != 0, tWDFlash, tWDErase, tWDFuse, tReset},
+
+static const simDeviceType simDevices[] = {DEVICE_LIST(SIM_DEVICE)};
+
+const simDeviceType *findSimDevice(const char *name)
+{
+	for (const simDeviceType &d : simDevices)
+		if (strcmp(d.name, name) == 0)
+			return &d;
+	return NULL;
+} // end of findSimDevice
+
+// instructions, as the programmer sends them
+enum
+{
+	progamEnable = 0xAC,
+	chipErase = 0x80,
+	writeLockByte = 0xE0,
+	writeLowFuseByte = 0xA0,
+	writeHighFuseByte = 0xA8,
+	writeExtendedFuseByte = 0xA4,
+	programAcknowledge = 0x53,
+	pollReady = 0xF0,
+	readSignatureByte = 0x30,
+	readCalibrationByte = 0x38,
+	readLowOrExtendedFuse = 0x50, // 2nd byte 0x00 low, 0x08 extended
+	readHighFuseOrLock = 0x58,	  // 2nd byte 0x08 high, 0x00 lock
+	readProgramMemory = 0x20,	  // | 0x08 for the high byte
+	writeProgramMemory = 0x4C,
+	loadExtendedAddressByte = 0x4D,
+	loadProgramMemory = 0x40, // | 0x08 for the high byte
+};
+
+enum
+{
+	lowFuse,
+	highFuse,
+	extFuse,
+	lockByte,
+};
+
+// "unprogrammed" for anything that is not there, or not answered
+const uint8_t FLOATING = 0xFF;
+
+// SCK high and low each need 2 target clocks, 3 from 12 MHz
+const unsigned long FAST_TARGET_CLOCK = 12000000;
+
+// data sheet figure if the chip does not give one
+const unsigned int RESET_SETTLE_MS = 20;
+
+SimTarget::SimTarget(const simDeviceType &device, unsigned long targetClock)
+	: device(device), targetClock(targetClock), flash(device.flashSize, FLOATING),
+	  calibration(0x80), deadByte(-1), resetLow(false), resetAt(0), programming(false), outOfStep(false), position(0),
+	  output(FLOATING), pageBuffer(device.pageSize, FLOATING), extendedAddress(0), busyUntil(0)
+{
+	// factory fuses: 8 MHz RC / 8, SPI programming enabled, no lock
+	fuses[lowFuse] = 0x62;
+	fuses[highFuse] = 0xD9;
+	fuses[extFuse] = 0xFF;
+	fuses[lockByte] = 0xFF;
+	memset(&stats, 0, sizeof stats);
+} // end of SimTarget::SimTarget
+
+void SimTarget::setReset(bool low, unsigned long now)
+{
+	if (low == resetLow)
+		return;
+	resetLow = low;
+
+	// a new low level starts the settle time over, and the frames from the start
+	if (low)
+	{
+		stats.resets++;
+		resetAt = now;
+		outOfStep = false;
+	}
+	programming = false;
+	position = 0;
+	output = FLOATING;
+} // end of SimTarget::setReset
+
+uint8_t SimTarget::transfer(uint8_t in, unsigned long sck, unsigned long now)
+{
+	stats.spiBytes++;
+
+	if (!resetLow)
+		return FLOATING; // running, MISO is a normal pin
+
+	// too fast: the target samples garbage, and is out of step until reset
+	//  is pulsed again
+	if (tooFast(sck))
+	{
+		stats.badBytes++;
+		programming = false;
+		outOfStep = true;
+		position = 0;
+		return FLOATING;
+	}
+
+	// the bytes echo the one before, the 4th brings the answer, worked out
+	//  as soon as the instruction and address are in
+	const uint8_t result = output;
+	output = in;
+	frame[position++] = in;
+	if (position == 3)
+		output = answer(now);
+	else if (position == sizeof frame)
+	{
+		position = 0;
+		stats.frames++;
+		execute(now);
+	}
+	return result;
+} // end of SimTarget::transfer
+
+uint8_t SimTarget::sends(unsigned long sck) const
+{
+	return resetLow && !tooFast(sck) ? output : FLOATING;
+} // end of SimTarget::sends
+
+bool SimTarget::tooFast(unsigned long sck) const
+{
+	const unsigned long fraction = targetClock >= FAST_TARGET_CLOCK ? 6 : 4;
+	return sck * fraction > targetClock;
+} // end of SimTarget::tooFast
+
+void SimTarget::startWrite(unsigned int us, unsigned long now)
+{
+	busyUntil = now + us;
+	stats.busyMicros += us;
+} // end of SimTarget::startWrite
+
+// the byte a read instruction sends back on the 4th transfer
+uint8_t SimTarget::answer(unsigned long now) const
+{
+	if (!programming)
+		return FLOATING;
+
+	// while a write is going on only Poll RDY/BSY is answered
+	if (frame[0] == pollReady)
+		return device.timedWrites ? FLOATING : busy(now) ? 1 : 0; // no RDY/BSY on timed chips
+	if (busy(now))
+		return FLOATING;
+
+	const unsigned long word = ((unsigned long)extendedAddress << 16) | (frame[1] << 8) | frame[2];
+	const uint8_t high = frame[0] & 0x08 ? 1 : 0;
+
+	switch (frame[0])
+	{
+	case readSignatureByte:
+		return frame[2] < 3 ? device.sig[frame[2]] : FLOATING;
+
+	case readCalibrationByte:
+		return calibration;
+
+	case readLowOrExtendedFuse:
+		return fuses[frame[1] == 0x08 ? extFuse : lowFuse];
+
+	case readHighFuseOrLock:
+		return fuses[frame[1] == 0x08 ? highFuse : lockByte];
+
+	case readProgramMemory:
+	case readProgramMemory | 0x08:
+		return word * 2 + high < flash.size() ? flash[word * 2 + high] : FLOATING;
+
+	default:
+		return FLOATING;
+	} // end of switch on instruction
+} // end of SimTarget::answer
+
+// carries out one complete instruction
+void SimTarget::execute(unsigned long now)
+{
+	// programming enable is taken once RESET has been low long enough
+	if (!programming)
+	{
+		const unsigned long settle = (device.tReset ? device.tReset : RESET_SETTLE_MS) * 1000UL;
+		if (frame[0] == progamEnable && frame[1] == programAcknowledge && !outOfStep &&
+			now - resetAt >= settle)
+			programming = true;
+		else
+			stats.ignoredFrames++;
+		return;
+	}
+
+	if (frame[0] == pollReady)
+	{
+		stats.polls++;
+		if (busy(now))
+			stats.busyPolls++;
+		return;
+	}
+	if (busy(now))
+	{
+		stats.ignoredFrames++;
+		return;
+	}
+
+	const unsigned int pageWords = device.pageSize / 2;
+	const unsigned long word = ((unsigned long)extendedAddress << 16) | (frame[1] << 8) | frame[2];
+	const uint8_t high = frame[0] & 0x08 ? 1 : 0;
+
+	switch (frame[0])
+	{
+	case progamEnable:
+		switch (frame[1])
+		{
+		case programAcknowledge:
+			break; // already enabled
+
+		case chipErase:
+			flash.assign(flash.size(), FLOATING);
+			fuses[lockByte] = FLOATING;
+			stats.erases++;
+			startWrite(device.tWDErase, now);
+			break;
+
+		case writeLowFuseByte:
+		case writeHighFuseByte:
+		case writeExtendedFuseByte:
+		case writeLockByte:
+		{
+			const uint8_t which = frame[1] == writeLowFuseByte ? lowFuse
+								  : frame[1] == writeHighFuseByte ? highFuse
+								  : frame[1] == writeExtendedFuseByte ? extFuse
+																	 : lockByte;
+			if ((device.fuseMask & (1 << which)) == 0)
+			{
+				stats.ignoredFrames++;
+				break;
+			}
+			// lock bits can only be programmed, erase clears them
+			fuses[which] = which == lockByte ? fuses[which] & frame[3] : frame[3];
+			stats.fuseWrites++;
+			startWrite(device.tWDFuse, now);
+		}
+		break;
+
+		default:
+			stats.ignoredFrames++;
+			break;
+		} // end of switch on write instruction
+		break;
+
+	case readSignatureByte:
+	case readCalibrationByte:
+	case readLowOrExtendedFuse:
+	case readHighFuseOrLock:
+	case readProgramMemory:
+	case readProgramMemory | 0x08:
+		break; // answered already
+
+	case loadExtendedAddressByte:
+		extendedAddress = frame[2];
+		break;
+
+	case loadProgramMemory:
+	case loadProgramMemory | 0x08:
+		pageBuffer[(word % pageWords) * 2 + high] = frame[3];
+		break;
+
+	case writeProgramMemory:
+	{
+		// flash bits only go from 1 to 0 without an erase
+		const unsigned long start = (word - word % pageWords) * 2;
+		if (start + device.pageSize <= flash.size())
+			for (unsigned int i = 0; i < device.pageSize; i++)
+				flash[start + i] &= pageBuffer[i];
+		if (deadByte >= 0 && (unsigned long)deadByte < flash.size())
+			flash[deadByte] = FLOATING;
+		pageBuffer.assign(pageBuffer.size(), FLOATING);
+		stats.pagesCommitted++;
+		startWrite(device.tWDFlash, now);
+	}
+	break;
+
+	default:
+		stats.ignoredFrames++;
+		break;
+	} // end of switch on instruction
+} // end of SimTarget::execute
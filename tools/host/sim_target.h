@@ -0,0 +1,112 @@
+// sim_target - a simulated AVR in serial programming mode, for host builds
+//
+// SimTarget answers the ISP instructions the programmer uses one SPI byte at
+//  a time, as the chip does: programming enable (only while RESET is held
+//  low, some time after the last reset pulse), signature, fuse, lock and
+//  calibration reads, fuse and lock writes, chip erase, load extended
+//  address, load / read / write program memory, and Poll RDY/BSY. Writes
+//  keep the target busy for the chip's tWD_ figure from devices.h, and
+//  the byte clocked out during a busy write is garbage, as on a chip that
+//  is not polled.
+//
+// Time is simulated: the caller passes "now" in microseconds. The transport
+//  shim in sim_transport.cpp does that for the programmer (ISP_HOST).
+
+#ifndef sim_target_h
+#define sim_target_h
+
+#include <stdint.h>
+#include <vector>
+
+// one chip from devices.h
+typedef struct
+{
+	uint8_t sig[3];
+	const char *name;
+	uint32_t flashSize;
+	uint16_t eepromSize;
+	uint16_t pageSize;
+	uint8_t eepromPageSize;
+	uint16_t bootSize;
+	uint8_t bootFuse;
+	uint8_t fuseMask;
+	bool timedWrites;
+	uint16_t tWDFlash;
+	uint16_t tWDErase;
+	uint16_t tWDFuse;
+	uint8_t tReset;
+} simDeviceType;
+
+// NULL if devices.h has no chip of that name
+const simDeviceType *findSimDevice(const char *name);
+
+// what the target saw, for benchmarks
+typedef struct
+{
+	unsigned long spiBytes;
+	unsigned long frames;		 // complete 4 byte instructions
+	unsigned long badBytes;		 // clocked in with SCK too fast
+	unsigned long ignoredFrames; // not in programming mode, busy, or unknown
+	unsigned long resets;		 // reset pulses
+	unsigned long polls;		 // Poll RDY/BSY instructions
+	unsigned long busyPolls;	 // ... answered busy
+	unsigned long pagesCommitted;
+	unsigned long erases;
+	unsigned long fuseWrites;
+	unsigned long busyMicros; // total time spent in writes
+} simStatsType;
+
+class SimTarget
+{
+public:
+	// targetClock: the chip's system clock, SCK has to stay below a quarter
+	//  of it (a sixth from 12 MHz), factory default is 8 MHz RC / 8
+	SimTarget(const simDeviceType &device, unsigned long targetClock = 1000000);
+
+	// RESET as driven by the programmer, true for low (programming)
+	void setReset(bool low, unsigned long now);
+
+	// one byte each way at SCK "sck" Hz, returns the byte the target sends
+	uint8_t transfer(uint8_t in, unsigned long sck, unsigned long now);
+
+	// the byte the next transfer at "sck" will send, which does not depend
+	//  on the byte coming in (for clocking the target bit by bit)
+	uint8_t sends(unsigned long sck) const;
+
+	// true while a write is still going on
+	bool busy(unsigned long now) const { return now < busyUntil; }
+
+	const simDeviceType &device;
+	unsigned long targetClock;
+
+	std::vector<uint8_t> flash;
+	uint8_t fuses[4]; // low, high, extended, lock (same order as the programmer)
+	uint8_t calibration;
+
+	// flash byte that stays erased (0xFF) whatever is written, -1 for none:
+	//  a worn cell, for the gang programming tests
+	long deadByte;
+
+	simStatsType stats;
+
+private:
+	bool tooFast(unsigned long sck) const;
+	uint8_t answer(unsigned long now) const;
+	void execute(unsigned long now);
+	void startWrite(unsigned int us, unsigned long now);
+
+	bool resetLow;
+	unsigned long resetAt; // when RESET last went low
+	bool programming;	   // programming enable accepted since then
+	bool outOfStep;		   // lost bits since then, needs a new reset pulse
+
+	uint8_t frame[4]; // instruction being clocked in
+	uint8_t position; // bytes of it so far
+	uint8_t output;	  // byte to send with the next transfer
+
+	std::vector<uint8_t> pageBuffer; // the chip's temporary page
+	uint8_t extendedAddress;
+	unsigned long busyUntil;
+};
+
+#endif
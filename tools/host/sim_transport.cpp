@@ -0,0 +1,71 @@
+// sim_transport - the ISP_HOST transport, see sim_transport.h
+
+#include "sim_transport.h"
+
+#include <stddef.h>
+
+// delay between clock edges, in the programmer (set by setISPSpeed)
+extern uint8_t bbDelay;
+
+unsigned long hostMicros = 0;
+SimTarget *simTargets[HOST_MAX_TARGETS];
+void (*hostClockHook)(unsigned long now) = NULL;
+void (*hostPinWatch)() = NULL;
+
+static const volatile uint8_t *resetPort = NULL;
+static const volatile uint8_t *resetDdr = NULL;
+static uint8_t resetMask = 0;
+
+void hostAttachReset(const volatile uint8_t *port, const volatile uint8_t *ddr, uint8_t bit)
+{
+	resetPort = port;
+	resetDdr = ddr;
+	resetMask = 1 << bit;
+} // end of hostAttachReset
+
+// RESET is low while driven low, the target's pull-up holds it high otherwise
+static void sampleReset()
+{
+	if (resetPort == NULL)
+		return;
+	const bool low = (*resetDdr & resetMask) && (*resetPort & resetMask) == 0;
+	for (SimTarget *target : simTargets)
+		if (target != NULL)
+			target->setReset(low, hostMicros);
+} // end of sampleReset
+
+void hostAdvance(unsigned long us)
+{
+	sampleReset();
+	if (hostPinWatch != NULL)
+		hostPinWatch();
+	hostMicros += us;
+	if (hostClockHook != NULL)
+		hostClockHook(hostMicros);
+} // end of hostAdvance
+
+unsigned long hostSCK()
+{
+	return 1000000UL / (2 * bbDelay + HOST_BIT_OVERHEAD_US);
+} // end of hostSCK
+
+uint8_t hostSPITransfer(uint8_t c)
+{
+	uint8_t in;
+	return hostGangTransfer(c, &in, 1);
+} // end of hostSPITransfer
+
+uint8_t hostGangTransfer(uint8_t c, uint8_t *in, uint8_t targets)
+{
+	const unsigned long now = hostMicros;
+	hostAdvance(8UL * (2 * bbDelay + HOST_BIT_OVERHEAD_US));
+
+	// every target on the header clocks the byte in, whether it is read or not
+	for (uint8_t t = 0; t < HOST_MAX_TARGETS; t++)
+	{
+		const uint8_t answer = simTargets[t] != NULL ? simTargets[t]->transfer(c, hostSCK(), now) : 0xFF;
+		if (t < targets)
+			in[t] = answer;
+	} // end of for each target
+	return in[0];
+} // end of hostGangTransfer
@@ -0,0 +1,58 @@
+// sim_transport - the ISP_HOST transport: connects the programmer to a
+//  SimTarget, on a simulated clock
+//
+// Built with -D ISP_TRANSPORT=3 (ISP_HOST) the programmer sends its bytes
+//  through hostSPITransfer instead of the bit banged pins. Each byte takes
+//  as long as the bit banged transport would at the current bbDelay, and
+//  the target sees SCK at that rate, so speed negotiation behaves as it
+//  does on the board. RESET is read from the port registers the programmer
+//  drives, whenever time moves on.
+//
+// Up to HOST_MAX_TARGETS targets share SCK, MOSI and RESET, as a gang build
+//  (-D GANG_TARGETS=...) wires them; each has its own MISO.
+
+#ifndef sim_transport_h
+#define sim_transport_h
+
+#include <stdint.h>
+
+#include "sim_target.h"
+
+// time per SPI bit on top of the two bbDelay waits, uS (pin access and loop
+//  on the board)
+const unsigned int HOST_BIT_OVERHEAD_US = 2;
+
+// simulated time since start, uS
+extern unsigned long hostMicros;
+
+// targets on the ISP header, simTargets[0] is the one a single target
+//  build talks to, NULL for none
+const uint8_t HOST_MAX_TARGETS = 8;
+extern SimTarget *simTargets[HOST_MAX_TARGETS];
+
+// where RESET is: bit "bit" of the port's output and direction registers
+void hostAttachReset(const volatile uint8_t *port, const volatile uint8_t *ddr, uint8_t bit);
+
+// let "us" microseconds pass (delay, delayMicroseconds, busy loops)
+void hostAdvance(unsigned long us);
+
+// called with the new time whenever it moves on, NULL for none (the
+//  native build's timer interrupts)
+extern void (*hostClockHook)(unsigned long now);
+
+// called before time moves on and after each timer interrupt, to see the
+//  pins the programmer drives; NULL for none (queue_test.cpp clocks the
+//  target from the bit banged pins with it)
+extern void (*hostPinWatch)();
+
+// SCK the programmer runs at, Hz
+unsigned long hostSCK();
+
+// ISP_HOST transfer, one byte each way
+uint8_t hostSPITransfer(uint8_t c);
+
+// the same byte to the first "targets" targets at once, in[n] gets target
+//  n's answer (MISO floats high where there is none), returns in[0]
+uint8_t hostGangTransfer(uint8_t c, uint8_t *in, uint8_t targets);
+
+#endif